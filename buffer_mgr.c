@@ -1,6 +1,10 @@
 #include "buffer_mgr.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sched.h>
+#include <time.h>
 #include "dberror.h"
 #include "storage_mgr.h"
 
@@ -11,7 +15,9 @@ typedef enum ReplacementStrategy {
   RS_LRU = 1,
   RS_CLOCK = 2,
   RS_LFU = 3,
-  RS_LRU_K = 4
+  RS_LRU_K = 4,
+  RS_ARC = 5,
+  RS_2Q = 6
 } ReplacementStrategy;
 
 // Data Types and Structures
@@ -26,7 +32,6 @@ typedef struct BM_BufferPool {
                   // manager needs for a buffer pool
   int numReadIO;
   int numWriteIO;
-  int timer;
 } BM_BufferPool;
 
 typedef struct BM_PageHandle {
@@ -40,6 +45,78 @@ typedef struct BM_PageHandle {
  */
 
 
+static RC initFrameList(BM_ListData *list, int n);
+static void freeFrameList(BM_ListData *list);
+static void listAppendFrame(BM_ListData *list, int frame);
+static void listPrependFrame(BM_ListData *list, int frame);
+static RC initGhostData(BM_GhostData *ghosts, int n);
+static void freeGhostData(BM_GhostData *ghosts);
+static void listUnlinkFrame(BM_ListData *list, int frame);
+static void lfuCountPin(BM_LFUData *lfu, int frame);
+static void lfuUnlinkFrame(BM_LFUData *lfu, int frame);
+static void lfuPrefetchFrame(BM_LFUData *lfu, int frame);
+static void ghostForget(BM_GhostData *ghosts, BM_ListData *list, int slot);
+static void ghostRemember(BM_GhostData *ghosts, BM_ListData *list, PageNumber pageNum);
+static int chooseVictim(BM_BufferPool *bm);
+static bool frameInWindow(BM_BufferPool *bm, int frame);
+static bool frameEvictable(BM_BufferPool *bm, int frame);
+static int admissionWindowVictim(BM_BufferPool *bm);
+static void admissionTakeWindowFrame(BM_BufferPool *bm, int frame);
+static RC initPoolLatches(BM_BufferPool *bm);
+static void freePoolResources(BM_BufferPool *bm);
+static RC initPoolFrames(BM_BufferPool *bm, void *stratData);
+static RC initPartitions(BM_BufferPool *bm, void *stratData);
+static void initIOBackend(BM_BufferPool *bm);
+static RC readMappedFrame(BM_BufferPool *bm, int frame, PageNumber pageNum);
+static BM_BufferPool *partitionOf(BM_BufferPool *bm, PageNumber pageNum);
+static BM_BufferPool *partitionOfFrame(BM_BufferPool *bm, int i, int *frame);
+static RC flushFrame(BM_BufferPool *bm, int frame);
+static bool claimFlushFrame(BM_BufferPool *bm, int frame, PageNumber *pageNum);
+static void releaseFlushFrame(BM_BufferPool *bm, int frame, RC written);
+static int compareFlushEntries(const void *a, const void *b);
+static RC writeFrames(BM_BufferPool *bm, const PageNumber *pageNums, int numPages, char **data, RC *results);
+static RC readFrames(BM_BufferPool *bm, const PageNumber *pageNums, int numPages, char **data, RC *results, bool prefetch);
+static RC mapFrame(BM_BufferPool *bm, PageNumber pageNum, bool prefetch, int *frame, PageNumber *victimPage, bool *victimDirty);
+static RC finishLoad(BM_BufferPool *bm, int frame, PageNumber pageNum, RC read, bool prefetch);
+static void unpinFrame(BM_BufferPool *bm, int frame);
+static void readAheadAfter(BM_BufferPool *bm, PageNumber pageNum);
+static void readAhead(BM_BufferPool *bm, PageNumber first, PageNumber last);
+static void setPageHandle(BM_BufferPool *bm, BM_PageHandle *page, int frame, PageNumber pageNum);
+static int comparePinEntries(const void *a, const void *b);
+static RC writeMissVictims(BM_BufferPool *bm, BM_PinEntry *entries, int numEntries);
+static RC readMisses(BM_BufferPool *bm, BM_PinEntry *entries, int numEntries);
+static RC startPrefetcher(BM_BufferPool *bm);
+static void stopPrefetcher(BM_BufferPool *bm);
+static void *prefetcherMain(void *arg);
+static int comparePrefetchEntries(const void *a, const void *b);
+static RC startFlusher(BM_BufferPool *bm);
+static RC restartBackgroundThreads(BM_BufferPool *bm, bool prefetcher, RC failed);
+static void stopFlusher(BM_BufferPool *bm);
+static void *flusherMain(void *arg);
+static void flusherPass(BM_BufferPool *bm, int *order);
+static int evictionOrder(BM_BufferPool *bm, int *order);
+static int appendListOrder(BM_BufferPool *bm, BM_ListData *list, int *order, int n);
+static unsigned int pageHashKey(PageNumber pageNum);
+static BM_PageTableShard *pageShard(BM_BufferPool *bm, PageNumber pageNum);
+static int pinnedFrame(BM_BufferPool *bm, BM_PageHandle *page);
+static RC readFrame(BM_BufferPool *bm, PageNumber pageNum, char *data);
+static RC writeFrame(BM_BufferPool *bm, PageNumber pageNum, char *data);
+static int pinResidentPage(BM_BufferPool *bm, PageNumber pageNum);
+static int pinFrameOptimistic(BM_BufferPool *bm, BM_PageTableShard *shard, PageNumber pageNum);
+static bool strategyTracksHits(BM_BufferPool *bm);
+static void recordHit(BM_BufferPool *bm, int frame, PageNumber pageNum, bool firstPin);
+static bool pushHit(BM_BufferPool *bm, int frame, PageNumber pageNum, unsigned long version);
+static void applyHits(BM_BufferPool *bm);
+static void applyHit(BM_BufferPool *bm, int frame, PageNumber pageNum, unsigned long version);
+static unsigned long frameState(BM_BufferPool *bm, int frame);
+static int framePins(BM_BufferPool *bm, int frame);
+static RC takeFrame(BM_BufferPool *bm, PageNumber pageNum, BM_PageTableShard *shard, bool cleanOnly, int *frame, BM_PageTableShard **victimShard, bool *victimDirty);
+static RC loadPage(BM_BufferPool *bm, PageNumber pageNum, bool empty, int *frame);
+static void restoreVictim(BM_BufferPool *bm, int frame, PageNumber pageNum, PageNumber victimPage);
+static void dropFrame(BM_BufferPool *bm, int frame);
+static RC initFrameArena(BM_BufferPool *bm);
+static void lfuAge(BM_LFUData *lfu, int numPages);
+
 // Buffer Manager Interface Pool Handling
 
 /***************************************************************
@@ -62,37 +139,214 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
                   const int numPages, ReplacementStrategy strategy,
                   void *stratData) {
-    FILE *file;
+    return initBufferPoolWithOptions(bm, pageFileName, numPages, strategy, stratData, NULL);
+}
+
+/***************************************************************
+ * Function Name: initBufferPoolWithOptions
+ *
+ * Description: same as initBufferPool, with the optional features of BM_PoolOptions. options may be NULL. With options->partitions > 1 the frames are split into that many independent sub-pools.
+ *
+ * Parameters: BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData, const BM_PoolOptions *options
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+                             const int numPages, ReplacementStrategy strategy,
+                             void *stratData, const BM_PoolOptions *options) {
     int i;
+    RC RC_flag;
 
-    file = fopen(pageFileName, "r");
-    if (file == NULL) {
+    if (options != NULL)
+        bm->options = *options;
+    else
+        memset(&(bm->options), 0, sizeof(BM_PoolOptions));
+
+    if (openPageFile((char *)pageFileName, &(bm->fileHandle)) != RC_OK) {
         return RC_FILE_NOT_FOUND;
-    } else {
-        fclose(file);
+    }
+    // the frames are page aligned, so every read and write of the pool can bypass the OS cache;
+    // a file system without O_DIRECT keeps the file buffered
+    if (bm->options.directIO)
+        setDirectIO(&(bm->fileHandle), TRUE);
+    // pins past the end of the file grow it by ftruncate, preallocated a whole extent at a time if asked;
+    // a file system without fallocate keeps growing sparse
+    if (bm->options.fileGrowth == SM_GROW_PREALLOCATE && !bm->options.readOnly)
+        setFileGrowth(&(bm->fileHandle), SM_GROW_PREALLOCATE, bm->options.growthExtentPages);
+    if (bm->options.readOnly) {
+        // the kernel reads the mapping ahead, guided by accessPattern
+        bm->options.readAheadPages = 0;
+        RC_flag = mapPageFile(&(bm->fileHandle), bm->options.accessPattern);
+        if (RC_flag != RC_OK) {
+            closePageFile(&(bm->fileHandle));
+            return RC_flag;
+        }
     }
     bm->pageFile = (char *)pageFileName;
     bm->numPages = numPages;
     bm->strategy = strategy;
-    BM_PageHandle* buff = (BM_PageHandle *)calloc(numPages, sizeof(BM_PageHandle));
+    bm->numReadIO = 0;
+    bm->numWriteIO = 0;
+    bm->numPrefetchIO = 0;
+    bm->numPrefetchHits = 0;
+    // a first pin of page 0 already continues a scan
+    for (i = 0; i < READ_AHEAD_STREAMS; i++) {
+        bm->streams[i].next = 0;
+        bm->streams[i].end = NO_PAGE;
+    }
+    bm->nextStream = 0;
+    bm->frameArena = NULL;
+    bm->pageTable = NULL;
+    bm->frameSync = NULL;
+    bm->freeFrames = NULL;
+    bm->strategyData = NULL;
+    bm->admission = NULL;
+    bm->mgmtData = NULL;
+    bm->partitions = NULL;
+    bm->numPartitions = 0;
+    bm->filePool = bm;
+    bm->flusher = NULL;
+    bm->prefetcher = NULL;
+    bm->numPrefetching = 0;
+    bm->hitBuffer = NULL;
+    bm->hitHead = 0;
+    bm->hitTail = 0;
+    pthread_mutex_init(&(bm->strategyLatch), NULL);
+    pthread_mutex_init(&(bm->fileLatch), NULL);
+
+    if (bm->options.partitions > 1 && numPages > 1)
+        RC_flag = initPartitions(bm, stratData);
+    else
+        RC_flag = initPoolFrames(bm, stratData);
+    if (RC_flag == RC_OK && bm->options.ioBackend == SM_IO_URING && !bm->options.readOnly)
+        initIOBackend(bm);
+    if (RC_flag == RC_OK && bm->options.backgroundFlush)
+        RC_flag = startFlusher(bm);
+    if (RC_flag != RC_OK) {
+        freePoolResources(bm);
+        return RC_flag;
+    }
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: initPoolFrames
+ *
+ * Description: set up the frames, latches and strategy of a pool whose numPages, strategy and options are already set. Used for a single pool and for every partition.
+ *
+ * Parameters: BM_BufferPool *bm, void *stratData
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC initPoolFrames(BM_BufferPool *bm, void *stratData) {
+    int i;
+
+    BM_PageHandle* buff = (BM_PageHandle *)calloc(bm->numPages, sizeof(BM_PageHandle));
     bm->mgmtData = buff;
-    for (i = 0; i < numPages; i++)
+    if (buff == NULL || initFrameArena(bm) != RC_OK || initPoolLatches(bm) != RC_OK)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    for (i = 0; i < bm->numPages; i++)
     {
         (bm->mgmtData + i)->dirty = 0;
         (bm->mgmtData + i)->fixCounts = 0;
-        (bm->mgmtData + i)->data = NULL;
+        // a read-only pool points its frames into the mapping when it loads them
+        (bm->mgmtData + i)->data = bm->frameArena != NULL ? bm->frameArena + (long)i * PAGE_SIZE : NULL;
         (bm->mgmtData + i)->pageNum = -1;
     }
-    bm->numReadIO = 0;
-    bm->numWriteIO = 0;
-    bm->timer = 0;
+
+    bm->freeFrames = (int *)malloc(bm->numPages * sizeof(int));
+    if (bm->freeFrames == NULL || initStrategyData(bm, stratData) != RC_OK)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    for (i = 0; i < bm->numPages; i++)
+        bm->freeFrames[i] = bm->numPages - 1 - i;
+    bm->numFreeFrames = bm->numPages;
+
+    bm->hitBuffer = (BM_HitRecord *)calloc(HIT_BUFFER_SIZE, sizeof(BM_HitRecord));
+    if (bm->hitBuffer == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    for (i = 0; i < HIT_BUFFER_SIZE; i++)
+        bm->hitBuffer[i].seq = i;
+
+    if (bm->options.admissionFilter && initAdmission(bm) != RC_OK)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: initPartitions
+ *
+ * Description: split the frames of bm into options.partitions sub-pools. Each one has its own frames, strategy, admission filter and latches, so misses of pages in different partitions never wait for each other. They share the page file and the I/O counters of bm. The first numPages % partitions partitions get one frame more.
+ *
+ * Parameters: BM_BufferPool *bm, void *stratData
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC initPartitions(BM_BufferPool *bm, void *stratData) {
+    BM_BufferPool *part;
+    int i;
+    RC RC_flag;
+
+    bm->numPartitions = bm->options.partitions < bm->numPages ? bm->options.partitions : bm->numPages;
+    bm->partitions = (BM_BufferPool *)calloc(bm->numPartitions, sizeof(BM_BufferPool));
+    if (bm->partitions == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+
+    for (i = 0; i < bm->numPartitions; i++) {
+        part = bm->partitions + i;
+        part->pageFile = bm->pageFile;
+        part->numPages = bm->numPages / bm->numPartitions + (i < bm->numPages % bm->numPartitions ? 1 : 0);
+        part->strategy = bm->strategy;
+        part->options = bm->options;
+        part->options.partitions = 0;
+        part->filePool = bm;
+        pthread_mutex_init(&(part->strategyLatch), NULL);
+        pthread_mutex_init(&(part->fileLatch), NULL);
+        RC_flag = initPoolFrames(part, stratData);
+        if (RC_flag != RC_OK)
+            return RC_flag;
+    }
     return RC_OK;
 }
 
+/***************************************************************
+ * Function Name: initIOBackend
+ *
+ * Description: switch the page file of a pool to io_uring and register the frame arenas of the pool or of its partitions, so runs of pages are read and written straight into the frames. Where the kernel offers no io_uring, or refuses to register the frames, the pool keeps the synchronous calls for that part.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void initIOBackend(BM_BufferPool *bm) {
+    struct iovec *arenas;
+    int n, i;
+
+    if (setIOBackend(&(bm->fileHandle), SM_IO_URING) != RC_OK)
+        return;
+    n = bm->partitions != NULL ? bm->numPartitions : 1;
+    arenas = (struct iovec *)malloc(n * sizeof(struct iovec));
+    if (arenas == NULL)
+        return;
+    for (i = 0; i < n; i++) {
+        arenas[i].iov_base = bm->partitions != NULL ? bm->partitions[i].frameArena : bm->frameArena;
+        arenas[i].iov_len = bm->partitions != NULL ? bm->partitions[i].frameArenaSize : bm->frameArenaSize;
+    }
+    registerIOBuffers(&(bm->fileHandle), arenas, n);
+    free(arenas);
+}
+
 /***************************************************************
  * Function Name: shutdownBufferPool
  *
- * Description: shutdownBufferPool destroys a buffer pool. This method should free up all resources associated with buffer pool. For example, it should free the memory allocated for page frames. If the buffer pool contains any dirty pages, then these pages should be written back to disk before destroying the pool. It is an error to shutdown a buffer pool that has pinned pages.
+ * Description: shutdownBufferPool destroys a buffer pool. This method should free up all resources associated with buffer pool. For example, it should free the memory allocated for page frames. If the buffer pool contains any dirty pages, then these pages should be written back to disk before destroying the pool. It is an error to shutdown a buffer pool that has pinned pages. The flusher and the prefetcher are stopped first; if the shutdown fails they are started again and the pool stays usable.
  *
  * Parameters: BM_BufferPool *const bm
  *
@@ -110,34 +364,59 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 
 
 RC shutdownBufferPool(BM_BufferPool *const bm) {
+    bool prefetching = (bm->prefetcher != NULL);
     int *fixCounts;
     int i;
     RC RC_flag;
 
+    // the flusher and the prefetcher pin the pages they write or read, stop them before looking at the fix counts
+    stopPrefetcher(bm);
+    stopFlusher(bm);
     fixCounts = getFixCounts(bm);
     for (i = 0; i < bm->numPages; ++i) {
         if (*(fixCounts + i)) {
             free(fixCounts);
-            return RC_SHUTDOWN_POOL_FAILED;
+            return restartBackgroundThreads(bm, prefetching, RC_SHUTDOWN_POOL_FAILED);
         }
     }
+    free(fixCounts);
 
     RC_flag = forceFlushPool(bm);
-    if (RC_flag != RC_OK) {
-        free(fixCounts);
-        return RC_flag;
-    }
+    if (RC_flag != RC_OK)
+        return restartBackgroundThreads(bm, prefetching, RC_flag);
 
-    freePagesBuffer(bm);
-    free(fixCounts);
-    free(bm->mgmtData);
+    freePoolResources(bm);
     return RC_OK;
 }
 
+/***************************************************************
+ * Function Name: restartBackgroundThreads
+ *
+ * Description: start the flusher and, if it ran before, the prefetcher again after shutdownBufferPool stopped them and then failed, so the pool keeps working as before. Return failed, or the error of a thread that could not be started.
+ *
+ * Parameters: BM_BufferPool *bm, bool prefetcher, RC failed
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC restartBackgroundThreads(BM_BufferPool *bm, bool prefetcher, RC failed) {
+    RC RC_flag = RC_OK;
+
+    if (bm->options.backgroundFlush)
+        RC_flag = startFlusher(bm);
+    if (prefetcher && RC_flag == RC_OK) {
+        pthread_mutex_lock(&(bm->fileLatch));
+        RC_flag = startPrefetcher(bm);
+        pthread_mutex_unlock(&(bm->fileLatch));
+    }
+    return (RC_flag != RC_OK) ? RC_flag : failed;
+}
+
 /***************************************************************
  * Function Name: forceFlushPool
  *
- * Description: forceFlushPool causes all dirty pages (with fix count 0) from the buffer pool to be written to disk.
+ * Description: forceFlushPool causes all dirty pages (with fix count 0) from the buffer pool to be written to disk. The dirty frames of all partitions are claimed first (see claimFlushFrame) and sorted by page number, then written with one writeFrames call: every run of consecutive pages is one vectored write, or the whole set is one io_uring batch, so a checkpoint becomes a few large sequential writes.
  *
  * Parameters: BM_BufferPool *const bm
  *
@@ -153,40 +432,53 @@ RC shutdownBufferPool(BM_BufferPool *const bm) {
 ***************************************************************/
 
 RC forceFlushPool(BM_BufferPool *const bm) {
-    bool *dirtyFlags;
-    int *fixCounts;
-    int i;
-    BM_PageHandle* page;
+    BM_FlushEntry *entries;
+    BM_BufferPool *part;
+    PageNumber *pages;
+    PageNumber pageNum;
+    char **data;
+    RC *results;
+    int i, n, frame;
     RC RC_flag;
 
-    dirtyFlags = getDirtyFlags(bm);
-    fixCounts = getFixCounts(bm);
+    entries = (BM_FlushEntry *)malloc(bm->numPages * sizeof(BM_FlushEntry));
+    pages = (PageNumber *)malloc(bm->numPages * sizeof(PageNumber));
+    data = (char **)malloc(bm->numPages * sizeof(char *));
+    results = (RC *)malloc(bm->numPages * sizeof(RC));
+    if (entries == NULL || pages == NULL || data == NULL || results == NULL) {
+        free(entries);
+        free(pages);
+        free(data);
+        free(results);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
 
+    // the dirty frames of every partition go out together
+    n = 0;
     for (i = 0; i < bm->numPages; ++i) {
-        if (*(dirtyFlags + i)) {
-//printf("%s\n",*(dirtyFlags)?"true":"false");
-            if (*(fixCounts + i)) {
-                continue;
-            } else {
-                page = ((bm->mgmtData) + i);
-                RC_flag = forcePage(bm, page);
-                if (RC_flag != RC_OK) {
-                    free(dirtyFlags);
-                    free(fixCounts);
-                    return RC_flag;
-                }
-            }
+        part = partitionOfFrame(bm, i, &frame);
+        if (claimFlushFrame(part, frame, &pageNum)) {
+            entries[n].pageNum = pageNum;
+            entries[n].frame = frame;
+            entries[n].pool = part;
+            n++;
         }
     }
-    for (i = 0; i < bm->numPages; ++i)
-    {
-        if (*(dirtyFlags + i))
-            ((bm->mgmtData) + i)->dirty = 0;
+    qsort(entries, n, sizeof(BM_FlushEntry), compareFlushEntries);
+    for (i = 0; i < n; i++) {
+        pages[i] = entries[i].pageNum;
+        data[i] = (entries[i].pool->mgmtData + entries[i].frame)->data;
     }
 
-    free(dirtyFlags);
-    free(fixCounts);
-    return RC_OK;
+    // every claimed frame is released, the first error is returned
+    RC_flag = (n > 0) ? writeFrames(bm, pages, n, data, results) : RC_OK;
+    for (i = 0; i < n; i++)
+        releaseFlushFrame(entries[i].pool, entries[i].frame, results[i]);
+    free(entries);
+    free(pages);
+    free(data);
+    free(results);
+    return RC_flag;
 }
 
 // Buffer Manager Interface Access Pages
@@ -194,7 +486,7 @@ RC forceFlushPool(BM_BufferPool *const bm) {
 /***************************************************************
  * Function Name: markDirty
  *
- * Description:mark a page as dirty
+ * Description:mark a page as dirty. A read-only pool refuses with RC_POOL_READ_ONLY, its pages live in a read-only mapping.
  *
  * Parameters: BM_BufferPool *const bm, BM_PageHandle *const page
  *
@@ -209,15 +501,19 @@ RC forceFlushPool(BM_BufferPool *const bm) {
 
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
 {
-    int i;
-    for (i = 0; i < (bm->numPages); i++)
+    int pnum;
+
+    if (bm->options.readOnly)
+        return RC_POOL_READ_ONLY;
+    if (bm->partitions != NULL)
+        return markDirty(partitionOf(bm, page->pageNum), page);
+
+    pnum = pinnedFrame(bm, page);
+
+    if (pnum != -1)
     {
-        if ((bm->mgmtData + i)->pageNum == page->pageNum)
-        {
-            page->dirty = 1;
-            (bm->mgmtData + i)->dirty = 1;
-            break;
-        }
+        page->dirty = 1;
+        __atomic_fetch_or(&(bm->frameSync[pnum].state), FRAME_DIRTY, __ATOMIC_ACQ_REL);
     }
     return RC_OK;
 }
@@ -240,17 +536,57 @@ RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
 
 RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page)
 {
-    int i;
-    for (i = 0; i < bm->numPages; i++)
+    int pnum;
+
+    if (bm->partitions != NULL)
+        return unpinPage(partitionOf(bm, page->pageNum), page);
+
+    pnum = pinnedFrame(bm, page);
+
+    if (pnum != -1)
+        unpinFrame(bm, pnum);
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: unpinFrame
+ *
+ * Description: release one pin of a frame. Only the last pin of an LRU frame changes the strategy and takes the strategy latch, every other unpin is one swap.
+ *
+ * Parameters: BM_BufferPool *bm, int pnum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void unpinFrame(BM_BufferPool *bm, int pnum) {
+    unsigned long state;
+
+    state = frameState(bm, pnum);
+    while ((state & FRAME_PIN_MASK) > 0)
+    {
+        if ((state & FRAME_PIN_MASK) == 1 && bm->strategy == RS_LRU && !frameInWindow(bm, pnum))
+            break;
+        if (__atomic_compare_exchange_n(&(bm->frameSync[pnum].state), &state, state - 1,
+                                        TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return;
+    }
+    if ((state & FRAME_PIN_MASK) == 0)
+        return;
+
+    pthread_mutex_lock(&(bm->strategyLatch));
+    state = frameState(bm, pnum);
+    while ((state & FRAME_PIN_MASK) > 0)
     {
-        if ((bm->mgmtData + i)->pageNum == page->pageNum)
+        if (__atomic_compare_exchange_n(&(bm->frameSync[pnum].state), &state, state - 1,
+                                        TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
         {
-            (bm->mgmtData + i)->fixCounts--;
-//          page->fixCounts--;
+            if ((state & FRAME_PIN_MASK) == 1)
+                releaseAttribute(bm, bm->mgmtData + pnum);
             break;
         }
     }
-    return RC_OK;
+    pthread_mutex_unlock(&(bm->strategyLatch));
 }
 
 /***************************************************************
@@ -271,35 +607,33 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page)
 
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page)
 {
-    FILE *fp;
-    int i;
+    int pnum;
+    RC RC_flag;
 
+    if (bm->partitions != NULL)
+        return forcePage(partitionOf(bm, page->pageNum), page);
 
+    pnum = pinnedFrame(bm, page);
 
-    fp = fopen(bm->pageFile, "rb+");
-    fseek(fp, (page->pageNum)*PAGE_SIZE, SEEK_SET);
-    fwrite(page->data, PAGE_SIZE, 1, fp);
-    (bm->numWriteIO)++;
-    fclose(fp);
-//      free(page->data);
-    for (i = 0; i < bm->numPages; i++)
+    // clear the flag before writing, so a markDirty during the write is not lost
+    if (pnum != -1)
+        __atomic_fetch_and(&(bm->frameSync[pnum].state), ~FRAME_DIRTY, __ATOMIC_ACQ_REL);
+
+    RC_flag = writeFrame(bm, page->pageNum, page->data);
+    if (RC_flag != RC_OK)
     {
-        if ((bm->mgmtData + i)->pageNum == page->pageNum)
-        {
-            (bm->mgmtData + i)->dirty = 0;
-//          (bm->mgmtData+i)->pageNum=-1;
-            break;
-        }
+        if (pnum != -1)
+            __atomic_fetch_or(&(bm->frameSync[pnum].state), FRAME_DIRTY, __ATOMIC_ACQ_REL);
+        return RC_flag;
     }
     page->dirty = 0;
-//page->pageNum=-1;
     return RC_OK;
 }
 
 /***************************************************************
  * Function Name: pinPage
  *
- * Description:pin a page, if the page does not exist in memory, read it from file
+ * Description:pin a page, if the page does not exist in memory, read it from file. The pages of a free-space map are refused with RC_HEADER_PAGE.
  *
  * Parameters:BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum
  *
@@ -316,169 +650,429 @@ RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
             const PageNumber pageNum)
 {
     int pnum;
-    int flag = 0;
-    int i;
+    RC RC_flag;
 
-    for (i = 0; i < bm->numPages; i++)
-    {
-        if ((bm->mgmtData + i)->pageNum == -1)
-        {
-            (bm->mgmtData + i)->data = (char*)calloc(PAGE_SIZE, sizeof(char));
-            pnum = i;
-            flag = 1;
-            break;
-        }
-        if ((bm->mgmtData + i)->pageNum == pageNum)
-        {
-            pnum = i;
-            flag = 2;
-            if (bm->strategy == RS_LRU)
-                updataAttribute(bm, bm->mgmtData + pnum);
-            break;
-        }
-        if (i == bm->numPages - 1)
-        {
+    if (pageNum >= 0 && pageNum < getNumHeaderPages(&(bm->filePool->fileHandle)))
+        return RC_HEADER_PAGE;
 
-            flag = 1;;
-            if (bm->strategy == RS_FIFO)
-            {
-                pnum = strategyFIFOandLRU(bm);
-                if ((bm->mgmtData + pnum)->dirty)
-                    forcePage (bm, bm->mgmtData + pnum);
-            }
-            if (bm->strategy == RS_LRU)
-            {
-                pnum = strategyFIFOandLRU(bm);
-                if ((bm->mgmtData + pnum)->dirty)
-                    forcePage (bm, bm->mgmtData + pnum);
-            }
-        }
+    if (bm->partitions != NULL) {
+        RC_flag = pinPage(partitionOf(bm, pageNum), page, pageNum);
+        if (RC_flag == RC_OK && bm->options.readAheadPages > 0)
+            readAheadAfter(bm, pageNum);
+        return RC_flag;
     }
-    if (flag == 1)
-    {
-        FILE* fp;
-        fp = fopen(bm->pageFile, "r");
-        fseek(fp, pageNum * PAGE_SIZE, SEEK_SET);
-        fread((bm->mgmtData + pnum)->data, sizeof(char), PAGE_SIZE, fp);
-        page->data = (bm->mgmtData + pnum)->data;
-        bm->numReadIO++;
-        ((bm->mgmtData + pnum)->fixCounts)++;
-        (bm->mgmtData + pnum)->pageNum = pageNum;
-        page->fixCounts = (bm->mgmtData + pnum)->fixCounts;
-        page->pageNum = pageNum;
-        page->dirty = (bm->mgmtData + pnum)->dirty;
-        page->strategyAttribute = (bm->mgmtData + pnum)->strategyAttribute;
-        updataAttribute(bm, bm->mgmtData + pnum);
-        fclose(fp);
-    }
-    if (flag == 2)
+
+    while (1)
     {
-        page->data = (bm->mgmtData + pnum)->data;
-        ((bm->mgmtData + pnum)->fixCounts)++;
-        page->fixCounts = (bm->mgmtData + pnum)->fixCounts;
-        page->pageNum = pageNum;
-        page->dirty = (bm->mgmtData + pnum)->dirty;
-        page->strategyAttribute = (bm->mgmtData + pnum)->strategyAttribute;
-        //if(bm->strategy==RS_LRU)
-        //  updataAttribute(bm, bm->mgmtData+pnum);
+        pnum = pinResidentPage(bm, pageNum);
+        if (pnum != -1)
+            break;
+        RC_flag = loadPage(bm, pageNum, FALSE, &pnum);
+        if (RC_flag != RC_OK)
+            return RC_flag;
+        if (pnum != -1)
+            break;
+        // another thread loaded the page first, pin its frame
     }
+
+    setPageHandle(bm, page, pnum, pageNum);
+
+    // a partition leaves read-ahead to the pool it belongs to
+    if (bm->filePool == bm && bm->options.readAheadPages > 0)
+        readAheadAfter(bm, pageNum);
     return RC_OK;
 }
 
-// Statistics Interface
-
 /***************************************************************
- * Function Name: getFrameContents
- *
- * Description: Returns an array of PageNumbers where the ith element is the number of the page stored in the ith page frame
- *
- * Parameters: BM_BufferPool *const bm
+ * Function Name: pinNewPage
  *
- * Return: PageNumber *
+ * Description: add a page at the end of the file and pin it, without any I/O. The page number is taken from the file's page count, the frame comes back zeroed and dirty, and the page reaches the disk when it is evicted or flushed; the file grows on disk only then. With SM_GROW_PREALLOCATE the blocks are reserved (reserveCapacity) as the count passes the preallocated extents. Reading a new page that was never written gives zeros, and ensureCapacity up to a count pinNewPage already reached does not extend the file on disk. In a file with a free-space map the page comes from allocatePage instead, which reuses the lowest free page or extends the file on disk, and a page that cannot be pinned is freed again. Fails with RC_POOL_READ_ONLY on a read-only pool.
  *
- * Author: Xincheng Yang
+ * Parameters: BM_BufferPool *const bm, BM_PageHandle *const page
  *
- * History:
- *      Date            Name                        Content
- *   2016/2/27      Xincheng Yang             first time to implement the function
+ * Return: RC
  *
 ***************************************************************/
-PageNumber *getFrameContents (BM_BufferPool *const bm) {
-    PageNumber *arr = (PageNumber*)malloc(bm->numPages * sizeof(PageNumber));
-    BM_PageHandle *handle = bm->mgmtData;
 
-    int i;
-    for (i = 0; i < bm->numPages; i++) {
-        if ((handle + i)->data == NULL) {
-            arr[i] = NO_PAGE;
-        } else {
-            arr[i] = (handle + i)->pageNum;
+RC pinNewPage (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    BM_BufferPool *file = bm->filePool;
+    BM_BufferPool *part;
+    PageNumber pageNum;
+    bool mapped;
+    int pnum;
+    RC RC_flag = RC_OK;
+
+    if (bm->options.readOnly)
+        return RC_POOL_READ_ONLY;
+
+    mapped = getNumHeaderPages(&(file->fileHandle)) > 0;
+    pthread_mutex_lock(&(file->fileLatch));
+    if (mapped)
+        RC_flag = allocatePage(&(file->fileHandle), &pageNum);
+    else {
+        // the count runs ahead of the file, a preallocated file reserves the blocks it passes
+        pageNum = file->fileHandle.totalNumPages;
+        RC_flag = reserveCapacity(pageNum + 1, &(file->fileHandle));
+        if (RC_flag == RC_OK)
+            file->fileHandle.totalNumPages++;
+    }
+    pthread_mutex_unlock(&(file->fileLatch));
+    if (RC_flag != RC_OK)
+        return RC_flag;
+
+    part = partitionOf(bm, pageNum);
+    while (1)
+    {
+        RC_flag = loadPage(part, pageNum, TRUE, &pnum);
+        if (RC_flag != RC_OK) {
+            // give the page back unless a later one was added meanwhile
+            pthread_mutex_lock(&(file->fileLatch));
+            if (mapped)
+                freePage(&(file->fileHandle), pageNum, FALSE);
+            else if (file->fileHandle.totalNumPages == pageNum + 1)
+                file->fileHandle.totalNumPages = pageNum;
+            pthread_mutex_unlock(&(file->fileLatch));
+            return RC_flag;
+        }
+        if (pnum != -1)
+            break;
+        // another thread pinned the page by its number first, share its frame
+        pnum = pinResidentPage(part, pageNum);
+        if (pnum != -1) {
+            // a reused page may still hold what it had before it was freed
+            if (mapped)
+                memset((part->mgmtData + pnum)->data, 0, PAGE_SIZE);
+            __atomic_fetch_or(&(part->frameSync[pnum].state), FRAME_DIRTY, __ATOMIC_ACQ_REL);
+            break;
         }
     }
-    return arr;
+
+    setPageHandle(part, page, pnum, pageNum);
+    return RC_OK;
 }
 
 /***************************************************************
- * Function Name: getDirtyFlags
- *
- * Description: Returns an array of bools where the ith element is TRUE if the page stored in the ith page frame is dirty
+ * Function Name: pinPages
  *
- * Parameters: BM_BufferPool *const bm
- *
- * Return: bool *
+ * Description: pin numPages pages at once and fill handles[i] for pageNums[i]. Hits are pinned first. The misses are then mapped to frames in page order, their dirty victims are written with one writeFrames call and the misses are read with one readFrames call, so every victim is written once, neighbouring misses share a read and, with the io_uring backend, all runs are in flight together. Repeated pages and pages past the end of the file are pinned one by one afterwards. If any page cannot be pinned, the pages pinned so far are unpinned and the error is returned. A page that holds the free-space map of the file fails the call with RC_HEADER_PAGE before anything is pinned.
  *
- * Author: Xincheng Yang
+ * Parameters: BM_BufferPool *const bm, BM_PageHandle *const handles, const PageNumber *pageNums, int numPages
  *
- * History:
- *      Date            Name                        Content
- *   2016/2/27      Xincheng Yang             first time to implement the function
+ * Return: RC
  *
 ***************************************************************/
-bool *getDirtyFlags (BM_BufferPool *const bm) {
-    bool *arr = (bool*)malloc(bm->numPages * sizeof(bool));
-    BM_PageHandle *handle = bm->mgmtData;
 
-    int i;
+RC pinPages (BM_BufferPool *const bm, BM_PageHandle *const handles,
+             const PageNumber *pageNums, int numPages)
+{
+    BM_PinEntry *entries;
+    PageNumber totalNumPages;
+    bool *pinned;
+    int i, headerPages;
+    RC RC_flag = RC_OK;
 
-    for (i = 0; i < bm->numPages; i++) {
-        arr[i] = (handle + i)->dirty;
+    if (numPages <= 0)
+        return RC_OK;
+    headerPages = getNumHeaderPages(&(bm->fileHandle));
+    for (i = 0; i < numPages; i++)
+        if (pageNums[i] >= 0 && pageNums[i] < headerPages)
+            return RC_HEADER_PAGE;
+    entries = (BM_PinEntry *)malloc(numPages * sizeof(BM_PinEntry));
+    pinned = (bool *)calloc(numPages, sizeof(bool));
+    if (entries == NULL || pinned == NULL) {
+        free(entries);
+        free(pinned);
+        return RC_MEMORY_ALLOCATION_FAIL;
     }
-    return arr;
+
+    for (i = 0; i < numPages; i++) {
+        entries[i].pool = partitionOf(bm, pageNums[i]);
+        entries[i].pageNum = pageNums[i];
+        entries[i].index = i;
+        entries[i].miss = FALSE;
+        entries[i].frame = pinResidentPage(entries[i].pool, pageNums[i]);
+    }
+
+    // map the misses in page order, a page asked for twice is mapped once
+    qsort(entries, numPages, sizeof(BM_PinEntry), comparePinEntries);
+    pthread_mutex_lock(&(bm->fileLatch));
+    totalNumPages = bm->fileHandle.totalNumPages;
+    pthread_mutex_unlock(&(bm->fileLatch));
+    for (i = 0; i < numPages; i++) {
+        if (entries[i].frame != -1 || bm->options.readOnly || entries[i].pageNum < 0 || entries[i].pageNum >= totalNumPages
+                || (i > 0 && entries[i].pageNum == entries[i - 1].pageNum))
+            continue;
+        RC_flag = mapFrame(entries[i].pool, entries[i].pageNum, FALSE, &(entries[i].frame),
+                           &(entries[i].victimPage), &(entries[i].victimDirty));
+        if (RC_flag != RC_OK)
+            break;
+        entries[i].miss = entries[i].frame != -1;
+    }
+
+    if (RC_flag == RC_OK)
+        RC_flag = writeMissVictims(bm, entries, numPages);
+    else
+        writeMissVictims(bm, entries, numPages);
+    if (RC_flag == RC_OK)
+        RC_flag = readMisses(bm, entries, numPages);
+    else
+        readMisses(bm, entries, numPages);
+
+    for (i = 0; i < numPages; i++) {
+        if (entries[i].frame != -1) {
+            setPageHandle(entries[i].pool, handles + entries[i].index, entries[i].frame, entries[i].pageNum);
+            pinned[entries[i].index] = TRUE;
+        }
+    }
+    // repeated pages, pages past the end of the file and pages loaded by another thread meanwhile
+    for (i = 0; i < numPages && RC_flag == RC_OK; i++) {
+        if (!pinned[i]) {
+            RC_flag = pinPage(bm, handles + i, pageNums[i]);
+            pinned[i] = RC_flag == RC_OK;
+        }
+    }
+
+    if (RC_flag != RC_OK) {
+        for (i = 0; i < numPages; i++) {
+            if (pinned[i])
+                unpinPage(bm, handles + i);
+        }
+    }
+    free(entries);
+    free(pinned);
+    return RC_flag;
 }
 
 /***************************************************************
- * Function Name: getFixCounts
- *
- * Description: Returns an array of ints where the ith element is the fix count of the page stored in the ith page frame
- *
- * Parameters: BM_BufferPool *const bm
+ * Function Name: prefetchPages
  *
- * Return: int *
+ * Description: ask for the given pages to be loaded without pinning them. A read-only pool only advises the kernel to read them into the mapping. Otherwise the pages are mapped to free or clean frames at once and read in the background by the prefetcher thread, which the first call starts. A pin of such a page before its read is done waits for that read. Pages already in the pool, pages of the free-space map, pages past the end of the file and pages that find no free or clean frame are skipped. Pages waiting for their read hold at most half the frames of a pool or partition, so misses still find victims.
  *
- * Author: Xincheng Yang
+ * Parameters: BM_BufferPool *const bm, const PageNumber *pageNums, int numPages
  *
- * History:
- *      Date            Name                        Content
- *   2016/2/27      Xincheng Yang             first time to implement the function
+ * Return: RC
  *
 ***************************************************************/
-int *getFixCounts (BM_BufferPool *const bm) {
-    int *arr = (int*)malloc(bm->numPages * sizeof(int));
-    BM_PageHandle *handle = bm->mgmtData;
 
-    int i;
-    for (i = 0; i < bm->numPages; i++) {
-        arr[i] = (handle + i)->fixCounts;
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pageNums, int numPages) {
+    BM_PrefetcherData *prefetcher;
+    char *data;
+    BM_PrefetchEntry *entries;
+    BM_BufferPool *part;
+    PageNumber totalNumPages, victimPage;
+    bool victimDirty;
+    int i, n, pnum, headerPages;
+    RC RC_flag = RC_OK;
+
+    if (numPages <= 0)
+        return RC_OK;
+    headerPages = getNumHeaderPages(&(bm->fileHandle));
+
+    // a mapped page is loaded by the kernel, a hint is enough
+    if (bm->options.readOnly) {
+        for (i = 0; i < numPages; i++) {
+            if (pageNums[i] < headerPages)
+                continue;
+            data = getMappedPage(&(bm->fileHandle), pageNums[i]);
+            if (data != NULL)
+                madvise(data, PAGE_SIZE, MADV_WILLNEED);
+        }
+        return RC_OK;
     }
-    return arr;
-}
 
-/***************************************************************
- * Function Name: getNumReadIO
- *
- * Description: Returns an array of ints where the ith element is the fix count of the page stored in the ith page frame
- *
- * Parameters: BM_BufferPool *const bm
+    pthread_mutex_lock(&(bm->fileLatch));
+    if (bm->prefetcher == NULL)
+        RC_flag = startPrefetcher(bm);
+    prefetcher = bm->prefetcher;
+    totalNumPages = bm->fileHandle.totalNumPages;
+    pthread_mutex_unlock(&(bm->fileLatch));
+    if (RC_flag != RC_OK)
+        return RC_flag;
+
+    entries = (BM_PrefetchEntry *)malloc(numPages * sizeof(BM_PrefetchEntry));
+    if (entries == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    for (i = 0; i < numPages; i++)
+        entries[i].pageNum = pageNums[i];
+    qsort(entries, numPages, sizeof(BM_PrefetchEntry), comparePrefetchEntries);
+
+    // map in page order, so the prefetcher finds the runs already sorted
+    n = 0;
+    for (i = 0; i < numPages; i++) {
+        if (entries[i].pageNum < headerPages || entries[i].pageNum >= totalNumPages)
+            continue;
+        part = partitionOf(bm, entries[i].pageNum);
+        if (__atomic_load_n(&(part->numPrefetching), __ATOMIC_RELAXED) >= part->numPages / 2)
+            continue;
+        if (mapFrame(part, entries[i].pageNum, TRUE, &pnum, &victimPage, &victimDirty) != RC_OK || pnum == -1)
+            continue;
+        entries[n].pool = part;
+        entries[n].pageNum = entries[i].pageNum;
+        entries[n].frame = pnum;
+        __atomic_add_fetch(&(part->numPrefetching), 1, __ATOMIC_RELAXED);
+        n++;
+    }
+
+    if (n > 0) {
+        pthread_mutex_lock(&(prefetcher->latch));
+        memcpy(prefetcher->queue + prefetcher->numQueued, entries, n * sizeof(BM_PrefetchEntry));
+        prefetcher->numQueued += n;
+        pthread_cond_signal(&(prefetcher->wake));
+        pthread_mutex_unlock(&(prefetcher->latch));
+    }
+    free(entries);
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: latchPage
+ *
+ * Description: take the content latch of a pinned page, shared for readers or exclusive for a writer. Pins only keep a page in the pool, threads that share a page use the latch to see whole updates.
+ *
+ * Parameters: BM_BufferPool *const bm, BM_PageHandle *const page, bool exclusive
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC latchPage (BM_BufferPool *const bm, BM_PageHandle *const page, bool exclusive)
+{
+    int pnum;
+
+    if (bm->partitions != NULL)
+        return latchPage(partitionOf(bm, page->pageNum), page, exclusive);
+
+    pnum = pinnedFrame(bm, page);
+
+    if (pnum == -1)
+        return RC_PAGE_NOT_PINNED;
+    if (exclusive)
+        pthread_rwlock_wrlock(&(bm->frameSync[pnum].latch));
+    else
+        pthread_rwlock_rdlock(&(bm->frameSync[pnum].latch));
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: unlatchPage
+ *
+ * Description: release the content latch taken by latchPage.
+ *
+ * Parameters: BM_BufferPool *const bm, BM_PageHandle *const page
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC unlatchPage (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    int pnum;
+
+    if (bm->partitions != NULL)
+        return unlatchPage(partitionOf(bm, page->pageNum), page);
+
+    pnum = pinnedFrame(bm, page);
+
+    if (pnum == -1)
+        return RC_PAGE_NOT_PINNED;
+    pthread_rwlock_unlock(&(bm->frameSync[pnum].latch));
+    return RC_OK;
+}
+
+// Statistics Interface
+
+/***************************************************************
+ * Function Name: getFrameContents
+ *
+ * Description: Returns an array of PageNumbers where the ith element is the number of the page stored in the ith page frame
+ *
+ * Parameters: BM_BufferPool *const bm
+ *
+ * Return: PageNumber *
+ *
+ * Author: Xincheng Yang
+ *
+ * History:
+ *      Date            Name                        Content
+ *   2016/2/27      Xincheng Yang             first time to implement the function
+ *
+***************************************************************/
+PageNumber *getFrameContents (BM_BufferPool *const bm) {
+    PageNumber *arr = (PageNumber*)malloc(bm->numPages * sizeof(PageNumber));
+    BM_BufferPool *part;
+
+    int i, frame;
+    for (i = 0; i < bm->numPages; i++) {
+        part = partitionOfFrame(bm, i, &frame);
+        arr[i] = (part->mgmtData + frame)->pageNum;
+    }
+    return arr;
+}
+
+/***************************************************************
+ * Function Name: getDirtyFlags
+ *
+ * Description: Returns an array of bools where the ith element is TRUE if the page stored in the ith page frame is dirty
+ *
+ * Parameters: BM_BufferPool *const bm
+ *
+ * Return: bool *
+ *
+ * Author: Xincheng Yang
+ *
+ * History:
+ *      Date            Name                        Content
+ *   2016/2/27      Xincheng Yang             first time to implement the function
+ *
+***************************************************************/
+bool *getDirtyFlags (BM_BufferPool *const bm) {
+    bool *arr = (bool*)malloc(bm->numPages * sizeof(bool));
+    BM_BufferPool *part;
+
+    int i, frame;
+
+    for (i = 0; i < bm->numPages; i++) {
+        part = partitionOfFrame(bm, i, &frame);
+        arr[i] = (frameState(part, frame) & FRAME_DIRTY) != 0;
+    }
+    return arr;
+}
+
+/***************************************************************
+ * Function Name: getFixCounts
+ *
+ * Description: Returns an array of ints where the ith element is the fix count of the page stored in the ith page frame
+ *
+ * Parameters: BM_BufferPool *const bm
+ *
+ * Return: int *
+ *
+ * Author: Xincheng Yang
+ *
+ * History:
+ *      Date            Name                        Content
+ *   2016/2/27      Xincheng Yang             first time to implement the function
+ *
+***************************************************************/
+int *getFixCounts (BM_BufferPool *const bm) {
+    int *arr = (int*)malloc(bm->numPages * sizeof(int));
+    BM_BufferPool *part;
+
+    int i, frame;
+    for (i = 0; i < bm->numPages; i++) {
+        part = partitionOfFrame(bm, i, &frame);
+        arr[i] = (int)(frameState(part, frame) & FRAME_PIN_MASK);
+    }
+    return arr;
+}
+
+/***************************************************************
+ * Function Name: getNumReadIO
+ *
+ * Description: Returns an array of ints where the ith element is the fix count of the page stored in the ith page frame
+ *
+ * Parameters: BM_BufferPool *const bm
  *
  * Return: int
  *
@@ -514,86 +1108,66 @@ int getNumWriteIO (BM_BufferPool *const bm) {
 }
 
 /***************************************************************
- * Function Name: strategyFIFOandLRU
+ * Function Name: getNumPrefetchIO
  *
- * Description: decide use which frame to save data using FIFO.
+ * Description: number of pages read ahead of a sequential scan. They are not part of getNumReadIO.
  *
- * Parameters: BM_BufferPool *bm
+ * Parameters: BM_BufferPool *const bm
  *
  * Return: int
  *
- * Author: Xiaoliang Wu
+***************************************************************/
+int getNumPrefetchIO (BM_BufferPool *const bm) {
+    return __atomic_load_n(&(bm->numPrefetchIO), __ATOMIC_RELAXED);
+}
+
+/***************************************************************
+ * Function Name: getNumPrefetchHits
  *
- * History:
- *      Date            Name                        Content
- *      16/02/27        Xiaoliang Wu                Complete
+ * Description: number of pins that found their page already read ahead.
+ *
+ * Parameters: BM_BufferPool *const bm
+ *
+ * Return: int
  *
 ***************************************************************/
-
-int strategyFIFOandLRU(BM_BufferPool *bm) {
-    int * attributes;
-    int * fixCounts;
-    int i;
-    int min, abortPage;
-
-    attributes = (int *)getAttributionArray(bm);
-    fixCounts = getFixCounts(bm);
-
-    min = bm->timer;
-    abortPage = -1;
-
-    for (i = 0; i < bm->numPages; ++i) {
-        if (*(fixCounts + i) != 0) continue;
-
-        if (min >= (*(attributes + i))) {
-            abortPage = i;
-            min = (*(attributes + i));
-        }
-    }
-
-    if ((bm->timer) > 32000) {
-        (bm->timer) -= min;
-        for (i = 0; i < bm->numPages; ++i) {
-            *(bm->mgmtData->strategyAttribute) -= min;
-        }
-    }
-    return abortPage;
+int getNumPrefetchHits (BM_BufferPool *const bm) {
+    return __atomic_load_n(&(bm->numPrefetchHits), __ATOMIC_RELAXED);
 }
 
 /***************************************************************
- * Function Name: getAttributionArray
+ * Function Name: strategyFIFOandLRU
  *
- * Description: return an array that includes all pages strategyAttribute.
+ * Description: decide use which frame to save data using FIFO or LRU. The victim is the first unpinned frame of the strategy list, no frame needs to be scanned or copied.
  *
  * Parameters: BM_BufferPool *bm
  *
- * Return: int*
+ * Return: int
  *
  * Author: Xiaoliang Wu
  *
  * History:
  *      Date            Name                        Content
- *      16/02/27        Xiaoliang Wu                Complete.
+ *      16/02/27        Xiaoliang Wu                Complete
  *
 ***************************************************************/
 
-int *getAttributionArray(BM_BufferPool *bm) {
-    int *attributes;
-    int *flag;
+int strategyFIFOandLRU(BM_BufferPool *bm) {
+    BM_ListData *list = (BM_ListData *)bm->strategyData;
     int i;
 
-    attributes = (int *)calloc(bm->numPages, sizeof((bm->mgmtData)->strategyAttribute));
-    for (i = 0; i < bm->numPages; ++i) {
-        flag = attributes + i;
-        *flag = *((bm->mgmtData + i)->strategyAttribute);
+    // both lists keep pinned frames, step over them
+    for (i = list->head; i != -1; i = list->next[i]) {
+        if (framePins(bm, i) == 0)
+            return i;
     }
-    return attributes;
+    return -1;
 }
 
 /***************************************************************
  * Function Name: freePagesBuffer
  *
- * Description: free all pages in pool.
+ * Description: free all pages in pool, they share one frame arena.
  *
  * Parameters: BM_BufferPool *bm
  *
@@ -608,17 +1182,52 @@ int *getAttributionArray(BM_BufferPool *bm) {
 ***************************************************************/
 
 void freePagesBuffer(BM_BufferPool *bm) {
-    int i;
-    for (i = 0; i < bm->numPages; ++i) {
-        free((bm->mgmtData + i)->data);
-        free((bm->mgmtData + i)->strategyAttribute);
+    if (bm->frameArena != NULL)
+        munmap(bm->frameArena, bm->frameArenaSize);
+    bm->frameArena = NULL;
+}
+
+/***************************************************************
+ * Function Name: initFrameArena
+ *
+ * Description: map one zeroed, page aligned arena for the data of all frames, so a miss never allocates and the frames can be used for direct I/O. With options.hugePages it asks for explicit huge pages first and else advises transparent ones.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC initFrameArena(BM_BufferPool *bm) {
+    long size = (long)bm->numPages * PAGE_SIZE;
+    void *arena = MAP_FAILED;
+
+    bm->frameArena = NULL;
+    bm->frameArenaSize = 0;
+    if (bm->options.readOnly)
+        return RC_OK;
+    if (bm->options.hugePages) {
+        long hugeSize = (size + FRAME_ARENA_HUGE_PAGE - 1) / FRAME_ARENA_HUGE_PAGE * FRAME_ARENA_HUGE_PAGE;
+        arena = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena != MAP_FAILED)
+            size = hugeSize;
+    }
+    if (arena == MAP_FAILED) {
+        arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED)
+            return RC_MEMORY_ALLOCATION_FAIL;
+        if (bm->options.hugePages)
+            madvise(arena, size, MADV_HUGEPAGE);
     }
+    bm->frameArena = (char *)arena;
+    bm->frameArenaSize = size;
+    return RC_OK;
 }
 
 /***************************************************************
  * Function Name: updataAttribute
  *
- * Description: modify the attribute about strategy. FIFO only use this function when page initial. LRU use this function when pinPage occurs.
+ * Description: modify the attribute about strategy. FIFO only use this function when page initial, it links the frame at the end of the FIFO list. LRU use this function when pinPage occurs, it takes the frame off the LRU list while it is pinned. CLOCK sets the reference bit of the frame on every pin. LRU-K records the pin in the reference history of the frame. LFU counts the pin and moves the frame to the next frequency bucket. ARC puts a new page in t1 and a hit or a ghost hit at the MRU end of t2. 2Q puts a new page in a1in, a page remembered by a1out in am, and moves am hits to the MRU end.
  *
  * Parameters: BM_BufferPool *bm, BM_PageHandle *pageHandle
  *
@@ -633,23 +1242,3341 @@ void freePagesBuffer(BM_BufferPool *bm) {
 ***************************************************************/
 
 RC updataAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle) {
-    // initial page strategy attribute assign buffer
-    if (pageHandle->strategyAttribute == NULL) {
+    // CLOCK only sets the reference bit, pins set it themselves
+    if (bm->strategy == RS_CLOCK) {
+        __atomic_fetch_or(&(bm->frameSync[pageHandle - bm->mgmtData].state), FRAME_REF, __ATOMIC_ACQ_REL);
+        return RC_OK;
+    }
+
+    if (bm->strategy == RS_LRU_K) {
+        BM_LRUKData *lruk = (BM_LRUKData *)bm->strategyData;
+        int frame = pageHandle - bm->mgmtData;
+        long *hist = lruk->history + (long)frame * lruk->k;
+        int i;
 
-        if (bm->strategy == RS_FIFO || bm->strategy == RS_LRU) {
-            pageHandle->strategyAttribute = calloc(1, sizeof(int));
+        lruk->now++;
+        if (lruk->last[frame] == 0) {
+            // first reference of a newly loaded page
+            hist[0] = lruk->now;
+            for (i = 1; i < lruk->k; i++)
+                hist[i] = 0;
+        } else if (lruk->now - lruk->last[frame] > lruk->correlatedPeriod) {
+            // a new uncorrelated reference, the correlated burst before it counts as one point in time
+            long burst = lruk->last[frame] - hist[0];
+            for (i = lruk->k - 1; i > 0; i--)
+                hist[i] = hist[i - 1] ? hist[i - 1] + burst : 0;
+            hist[0] = lruk->now;
         }
+        lruk->last[frame] = lruk->now;
+        return RC_OK;
+    }
 
+    if (bm->strategy == RS_LFU) {
+        BM_LFUData *lfu = (BM_LFUData *)bm->strategyData;
+
+        lfuCountPin(lfu, pageHandle - bm->mgmtData);
+        if (lfu->agingPeriod > 0 && ++(lfu->pinsSinceAging) >= lfu->agingPeriod) {
+            lfuAge(lfu, bm->numPages);
+            lfu->pinsSinceAging = 0;
+        }
+        return RC_OK;
     }
 
-    // assign number
-    if (bm->strategy == RS_FIFO || bm->strategy == RS_LRU) {
-        int * attribute;
-        attribute = (int *)pageHandle->strategyAttribute;
-        *attribute = (bm->timer);
-        (bm->timer)++;
+    if (bm->strategy == RS_ARC) {
+        BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+        int frame = pageHandle - bm->mgmtData;
+
+        if (arc->t1.linked[frame])
+            listUnlinkFrame(&(arc->t1), frame);
+        else if (arc->t2.linked[frame])
+            listUnlinkFrame(&(arc->t2), frame);
+        else if (!arc->missInB1 && !arc->missInB2) {
+            // a page loaded for the first time in a while
+            listAppendFrame(&(arc->t1), frame);
+            return RC_OK;
+        }
+        // a hit, or a page remembered by a ghost: it has been seen twice
+        listAppendFrame(&(arc->t2), frame);
+        arc->missInB1 = FALSE;
+        arc->missInB2 = FALSE;
+        return RC_OK;
+    }
+
+    if (bm->strategy == RS_2Q) {
+        BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+        int frame = pageHandle - bm->mgmtData;
+
+        if (twoQ->am.linked[frame]) {
+            listUnlinkFrame(&(twoQ->am), frame);
+            listAppendFrame(&(twoQ->am), frame);
+        } else if (twoQ->a1in.linked[frame]) {
+            // pins of a page in a1in are correlated, they do not promote it
+        } else if (twoQ->missInA1out) {
+            listAppendFrame(&(twoQ->am), frame);
+            twoQ->missInA1out = FALSE;
+        } else {
+            listAppendFrame(&(twoQ->a1in), frame);
+        }
+        return RC_OK;
+    }
+
+    if (bm->strategy == RS_FIFO) {
+        // only called when the page is loaded, FIFO order never changes after that
+        listAppendFrame((BM_ListData *)bm->strategyData, pageHandle - bm->mgmtData);
+        return RC_OK;
+    }
+
+    if (bm->strategy == RS_LRU) {
+        // pins leave the list alone so hits need no latch, the frame moves when released
         return RC_OK;
     }
 
     return RC_STRATEGY_NOT_FOUND;
 }
+
+/***************************************************************
+ * Function Name: releaseAttribute
+ *
+ * Description: modify the attribute about strategy when the last pin of a page is released. LRU links the frame as the most recently used one, or as the least recently used one while it holds a prefetched page nobody pinned yet.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PageHandle *pageHandle
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC releaseAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle) {
+    if (bm->strategy == RS_LRU) {
+        BM_ListData *list = (BM_ListData *)bm->strategyData;
+        int frame = pageHandle - bm->mgmtData;
+
+        if (list->linked[frame])
+            listUnlinkFrame(list, frame);
+        // a page read ahead was not referenced yet, it is the first one to go
+        if (frameState(bm, frame) & FRAME_PREFETCHED)
+            listPrependFrame(list, frame);
+        else
+            listAppendFrame(list, frame);
+    }
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: evictAttribute
+ *
+ * Description: modify the attribute about strategy when the page of a frame chosen by the strategy is really evicted. Until then the frame keeps its place in the strategy, so a caller may still decide to keep the page; only CLOCK has already cleared the reference bits its hand passed, the victim's included, and moved the hand past it.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PageHandle *pageHandle
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC evictAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle) {
+    int frame = pageHandle - bm->mgmtData;
+    int i;
+
+    switch (bm->strategy) {
+    case RS_FIFO:
+    case RS_LRU:
+        if (((BM_ListData *)bm->strategyData)->linked[frame])
+            listUnlinkFrame((BM_ListData *)bm->strategyData, frame);
+        break;
+    case RS_LRU_K: {
+        // the new page starts without history
+        BM_LRUKData *lruk = (BM_LRUKData *)bm->strategyData;
+
+        for (i = 0; i < lruk->k; i++)
+            lruk->history[(long)frame * lruk->k + i] = 0;
+        lruk->last[frame] = 0;
+        break;
+    }
+    case RS_LFU: {
+        BM_LFUData *lfu = (BM_LFUData *)bm->strategyData;
+
+        if (lfu->bucketOf[frame] != -1)
+            lfuUnlinkFrame(lfu, frame);
+        lfu->count[frame] = 0;
+        break;
+    }
+    case RS_ARC: {
+        BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+        BM_ListData *ghost;
+
+        if (arc->t1.linked[frame]) {
+            listUnlinkFrame(&(arc->t1), frame);
+            if (arc->dropFromT1)
+                break;
+            ghost = &(arc->b1);
+        } else {
+            listUnlinkFrame(&(arc->t2), frame);
+            ghost = &(arc->b2);
+        }
+        // remember the evicted page as a ghost
+        if (arc->ghosts.numFreeSlots == 0) {
+            BM_ListData *oldest = (arc->b1.length > arc->b2.length) ? &(arc->b1) : &(arc->b2);
+            ghostForget(&(arc->ghosts), oldest, oldest->head);
+        }
+        ghostRemember(&(arc->ghosts), ghost, pageHandle->pageNum);
+        break;
+    }
+    case RS_2Q: {
+        BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+
+        if (twoQ->am.linked[frame]) {
+            listUnlinkFrame(&(twoQ->am), frame);
+            break;
+        }
+        listUnlinkFrame(&(twoQ->a1in), frame);
+        if (twoQ->ghosts.numFreeSlots == 0)
+            ghostForget(&(twoQ->ghosts), &(twoQ->a1out), twoQ->a1out.head);
+        ghostRemember(&(twoQ->ghosts), &(twoQ->a1out), pageHandle->pageNum);
+        break;
+    }
+    default:
+        break;
+    }
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: forgetAttribute
+ *
+ * Description: take the frame off the strategy like evictAttribute, but without remembering its page as an ARC or 2Q ghost. Used for a page that was never referenced: a prefetched page evicted before its first pin, or a page whose load failed.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PageHandle *pageHandle
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC forgetAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle) {
+    int frame = pageHandle - bm->mgmtData;
+
+    if (bm->strategy == RS_ARC) {
+        BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+
+        if (arc->t1.linked[frame])
+            listUnlinkFrame(&(arc->t1), frame);
+        else if (arc->t2.linked[frame])
+            listUnlinkFrame(&(arc->t2), frame);
+        return RC_OK;
+    }
+    if (bm->strategy == RS_2Q) {
+        BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+
+        if (twoQ->a1in.linked[frame])
+            listUnlinkFrame(&(twoQ->a1in), frame);
+        else if (twoQ->am.linked[frame])
+            listUnlinkFrame(&(twoQ->am), frame);
+        return RC_OK;
+    }
+    return evictAttribute(bm, pageHandle);
+}
+
+/***************************************************************
+ * Function Name: prefetchAttribute
+ *
+ * Description: modify the attribute about strategy when a page is loaded by a prefetch instead of a pin. The page is not referenced yet, so it is linked where it is evicted first: FIFO appends it as for any load, CLOCK clears its reference bit, LRU-K leaves its history empty, LFU puts it in a bucket of frequency 0, ARC and 2Q link it at the LRU end of t1 and a1in. LRU links it when the prefetch releases it (see releaseAttribute). Its first pin calls prefetchHitAttribute.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PageHandle *pageHandle
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC prefetchAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle) {
+    int frame = pageHandle - bm->mgmtData;
+
+    switch (bm->strategy) {
+    case RS_FIFO:
+        return updataAttribute(bm, pageHandle);
+    case RS_CLOCK:
+        __atomic_fetch_and(&(bm->frameSync[frame].state), ~FRAME_REF, __ATOMIC_ACQ_REL);
+        break;
+    case RS_LFU:
+        lfuPrefetchFrame((BM_LFUData *)bm->strategyData, frame);
+        break;
+    case RS_ARC:
+        listPrependFrame(&(((BM_ARCData *)bm->strategyData)->t1), frame);
+        break;
+    case RS_2Q:
+        listPrependFrame(&(((BM_2QData *)bm->strategyData)->a1in), frame);
+        break;
+    default:
+        break;
+    }
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: prefetchHitAttribute
+ *
+ * Description: modify the attribute about strategy on the first pin of a prefetched page, which is its first reference. LRU-K and LFU count it like the pin of a newly loaded page. ARC and 2Q take the frame back off t1 or a1in and treat the pin like the miss the prefetch saved, so a ghost of the page still counts now. FIFO, LRU and CLOCK need nothing more than the pin itself.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PageHandle *pageHandle
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC prefetchHitAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle) {
+    int frame = pageHandle - bm->mgmtData;
+
+    if (bm->strategy == RS_ARC) {
+        BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+
+        if (arc->t1.linked[frame])
+            listUnlinkFrame(&(arc->t1), frame);
+        arcNoteMiss(bm, pageHandle->pageNum);
+        arcCommitMiss(bm, pageHandle->pageNum);
+        updataAttribute(bm, pageHandle);
+        arcCancelMiss(bm);
+        return RC_OK;
+    }
+    if (bm->strategy == RS_2Q) {
+        BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+
+        if (twoQ->a1in.linked[frame])
+            listUnlinkFrame(&(twoQ->a1in), frame);
+        twoQNoteMiss(bm, pageHandle->pageNum);
+        twoQCommitMiss(bm, pageHandle->pageNum);
+        updataAttribute(bm, pageHandle);
+        twoQ->missInA1out = FALSE;
+        return RC_OK;
+    }
+    if (bm->strategy == RS_LRU_K || bm->strategy == RS_LFU)
+        return updataAttribute(bm, pageHandle);
+    return RC_OK;
+}
+
+
+/***************************************************************
+ * Function Name: initPageTable
+ *
+ * Description: allocate an empty page table for a pool of numPages frames. The table keeps at least twice as many slots as frames so probe sequences stay short.
+ *
+ * Parameters: BM_PageTable *table, int numPages
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC initPageTable(BM_PageTable *table, int numPages) {
+    int i;
+
+    table->capacity = 16;
+    while (table->capacity < 2 * numPages)
+        table->capacity <<= 1;
+
+    table->keys = (PageNumber *)malloc(table->capacity * sizeof(PageNumber));
+    table->frames = (int *)malloc(table->capacity * sizeof(int));
+    if (table->keys == NULL || table->frames == NULL) {
+        freePageTable(table);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    for (i = 0; i < table->capacity; i++)
+        table->keys[i] = NO_PAGE;
+    table->count = 0;
+    table->retired = NULL;
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: freePageTable
+ *
+ * Description: release the slots of a page table.
+ *
+ * Parameters: BM_PageTable *table
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void freePageTable(BM_PageTable *table) {
+    if (table->retired != NULL) {
+        freePageTable(table->retired);
+        free(table->retired);
+    }
+    free(table->keys);
+    free(table->frames);
+    table->keys = NULL;
+    table->frames = NULL;
+    table->retired = NULL;
+    table->capacity = 0;
+}
+
+/***************************************************************
+ * Function Name: pageHashKey
+ *
+ * Description: pageNum folded to 32 bits for the multiplicative hashes, the high half is mixed in so pages 2^32 apart do not always collide.
+ *
+ * Parameters: PageNumber pageNum
+ *
+ * Return: unsigned int
+ *
+***************************************************************/
+
+static unsigned int pageHashKey(PageNumber pageNum) {
+    unsigned long long key = (unsigned long long)pageNum;
+
+    return (unsigned int)(key ^ (key >> 32));
+}
+
+/***************************************************************
+ * Function Name: pageTableSlot
+ *
+ * Description: home slot of pageNum, a multiplicative hash so consecutive page numbers spread over the table.
+ *
+ * Parameters: int capacity, PageNumber pageNum
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int pageTableSlot(int capacity, PageNumber pageNum) {
+    unsigned int h = pageHashKey(pageNum) * 2654435761u;
+    h ^= h >> 16;
+    return (int)(h & (unsigned int)(capacity - 1));
+}
+
+/***************************************************************
+ * Function Name: pageTableLookup
+ *
+ * Description: return the frame that holds pageNum, or -1 if the page is not in the pool. It may run without the latch of the table while another thread changes it: the answer can then be stale or wrong, and the caller has to check the frame.
+ *
+ * Parameters: BM_PageTable *table, PageNumber pageNum
+ *
+ * Return: int
+ *
+***************************************************************/
+
+int pageTableLookup(BM_PageTable *table, PageNumber pageNum) {
+    // growth stores the new arrays before the new capacity, so the capacity never exceeds the arrays
+    int capacity = __atomic_load_n(&(table->capacity), __ATOMIC_ACQUIRE);
+    PageNumber *keys = __atomic_load_n(&(table->keys), __ATOMIC_ACQUIRE);
+    int *frames = __atomic_load_n(&(table->frames), __ATOMIC_ACQUIRE);
+    int mask = capacity - 1;
+    PageNumber key;
+    int slot, i;
+
+    if (pageNum == NO_PAGE || capacity == 0)
+        return -1;
+    slot = pageTableSlot(capacity, pageNum);
+    for (i = 0; i < capacity; i++, slot = (slot + 1) & mask) {
+        key = __atomic_load_n(&(keys[slot]), __ATOMIC_RELAXED);
+        if (key == NO_PAGE)
+            return -1;
+        if (key == pageNum)
+            return __atomic_load_n(&(frames[slot]), __ATOMIC_RELAXED);
+    }
+    return -1;
+}
+
+/***************************************************************
+ * Function Name: pageTableReserve
+ *
+ * Description: make sure one more entry keeps the table at most half full, doubling and rehashing it if needed. The old arrays stay allocated until freePageTable because lock-free lookups may still read them.
+ *
+ * Parameters: BM_PageTable *table
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC pageTableReserve(BM_PageTable *table) {
+    BM_PageTable grown;
+    BM_PageTable *retired;
+    int i;
+
+    if (2 * (table->count + 1) <= table->capacity)
+        return RC_OK;
+    retired = (BM_PageTable *)malloc(sizeof(BM_PageTable));
+    if (retired == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    if (initPageTable(&grown, table->capacity) != RC_OK) {
+        free(retired);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    for (i = 0; i < table->capacity; i++) {
+        if (table->keys[i] != NO_PAGE)
+            pageTableInsert(&grown, table->keys[i], table->frames[i]);
+    }
+
+    *retired = *table;
+    table->retired = retired;
+    table->count = grown.count;
+    __atomic_store_n(&(table->keys), grown.keys, __ATOMIC_RELEASE);
+    __atomic_store_n(&(table->frames), grown.frames, __ATOMIC_RELEASE);
+    __atomic_store_n(&(table->capacity), grown.capacity, __ATOMIC_RELEASE);
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: pageTableInsert
+ *
+ * Description: record that pageNum now lives in frame. An existing entry for pageNum is overwritten. A table that can grow must be reserved first.
+ *
+ * Parameters: BM_PageTable *table, PageNumber pageNum, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void pageTableInsert(BM_PageTable *table, PageNumber pageNum, int frame) {
+    int mask = table->capacity - 1;
+    int slot;
+
+    slot = pageTableSlot(table->capacity, pageNum);
+    while (table->keys[slot] != NO_PAGE && table->keys[slot] != pageNum)
+        slot = (slot + 1) & mask;
+    if (table->keys[slot] == NO_PAGE)
+        table->count++;
+    // the frame first, a reader that finds the key must not see the frame of an older entry
+    __atomic_store_n(&(table->frames[slot]), frame, __ATOMIC_RELEASE);
+    __atomic_store_n(&(table->keys[slot]), pageNum, __ATOMIC_RELEASE);
+}
+
+/***************************************************************
+ * Function Name: pageTableRemove
+ *
+ * Description: drop the entry of pageNum. Later entries of the probe run are shifted back into the hole, so no tombstones are needed and lookups never slow down over time.
+ *
+ * Parameters: BM_PageTable *table, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void pageTableRemove(BM_PageTable *table, PageNumber pageNum) {
+    int mask = table->capacity - 1;
+    int hole, slot, home;
+
+    if (pageNum == NO_PAGE)
+        return;
+    for (hole = pageTableSlot(table->capacity, pageNum); table->keys[hole] != pageNum; hole = (hole + 1) & mask) {
+        if (table->keys[hole] == NO_PAGE)
+            return;
+    }
+
+    slot = hole;
+    while (1) {
+        slot = (slot + 1) & mask;
+        if (table->keys[slot] == NO_PAGE)
+            break;
+        home = pageTableSlot(table->capacity, table->keys[slot]);
+        // move the entry back if its home is not inside (hole, slot]
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            __atomic_store_n(&(table->frames[hole]), table->frames[slot], __ATOMIC_RELEASE);
+            __atomic_store_n(&(table->keys[hole]), table->keys[slot], __ATOMIC_RELEASE);
+            hole = slot;
+        }
+    }
+    __atomic_store_n(&(table->keys[hole]), NO_PAGE, __ATOMIC_RELEASE);
+    table->count--;
+}
+
+/***************************************************************
+ * Function Name: initStrategyData
+ *
+ * Description: allocate the pool wide bookkeeping of the replacement strategy. stratData carries strategy parameters and may be NULL.
+ *
+ * Parameters: BM_BufferPool *bm, void *stratData
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC initStrategyData(BM_BufferPool *bm, void *stratData) {
+    if (bm->strategy == RS_FIFO || bm->strategy == RS_LRU) {
+        BM_ListData *list;
+
+        list = (BM_ListData *)malloc(sizeof(BM_ListData));
+        if (list == NULL)
+            return RC_MEMORY_ALLOCATION_FAIL;
+        bm->strategyData = list;
+        if (initFrameList(list, bm->numPages) != RC_OK) {
+            freeStrategyData(bm);
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+    }
+    if (bm->strategy == RS_CLOCK) {
+        BM_ClockData *clock;
+
+        clock = (BM_ClockData *)malloc(sizeof(BM_ClockData));
+        if (clock == NULL)
+            return RC_MEMORY_ALLOCATION_FAIL;
+        clock->hand = 0;
+        bm->strategyData = clock;
+    }
+    if (bm->strategy == RS_LRU_K) {
+        BM_LRUKParams *params = (BM_LRUKParams *)stratData;
+        BM_LRUKData *lruk;
+
+        lruk = (BM_LRUKData *)malloc(sizeof(BM_LRUKData));
+        if (lruk == NULL)
+            return RC_MEMORY_ALLOCATION_FAIL;
+        lruk->k = (params != NULL && params->k > 0) ? params->k : 2;
+        lruk->correlatedPeriod = (params != NULL && params->correlatedPeriod > 0) ? params->correlatedPeriod : 0;
+        lruk->now = 0;
+        lruk->history = (long *)calloc((long)bm->numPages * lruk->k, sizeof(long));
+        lruk->last = (long *)calloc(bm->numPages, sizeof(long));
+        bm->strategyData = lruk;
+        if (lruk->history == NULL || lruk->last == NULL) {
+            freeStrategyData(bm);
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+    }
+    if (bm->strategy == RS_ARC) {
+        BM_ARCData *arc;
+
+        arc = (BM_ARCData *)calloc(1, sizeof(BM_ARCData));
+        if (arc == NULL)
+            return RC_MEMORY_ALLOCATION_FAIL;
+        bm->strategyData = arc;
+        // |b1| + |b2| never exceeds the number of frames
+        if (initFrameList(&(arc->t1), bm->numPages) != RC_OK || initFrameList(&(arc->t2), bm->numPages) != RC_OK
+                || initFrameList(&(arc->b1), bm->numPages) != RC_OK || initFrameList(&(arc->b2), bm->numPages) != RC_OK
+                || initGhostData(&(arc->ghosts), bm->numPages) != RC_OK) {
+            freeStrategyData(bm);
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+        arc->target = 0;
+    }
+    if (bm->strategy == RS_2Q) {
+        BM_2QParams *params = (BM_2QParams *)stratData;
+        BM_2QData *twoQ;
+
+        twoQ = (BM_2QData *)calloc(1, sizeof(BM_2QData));
+        if (twoQ == NULL)
+            return RC_MEMORY_ALLOCATION_FAIL;
+        bm->strategyData = twoQ;
+        twoQ->kin = bm->numPages * ((params != NULL && params->kinPercent > 0) ? params->kinPercent : 25) / 100;
+        twoQ->kout = bm->numPages * ((params != NULL && params->koutPercent > 0) ? params->koutPercent : 50) / 100;
+        if (twoQ->kin < 1)
+            twoQ->kin = 1;
+        if (twoQ->kout < 1)
+            twoQ->kout = 1;
+        if (initFrameList(&(twoQ->a1in), bm->numPages) != RC_OK || initFrameList(&(twoQ->am), bm->numPages) != RC_OK
+                || initFrameList(&(twoQ->a1out), twoQ->kout) != RC_OK
+                || initGhostData(&(twoQ->ghosts), twoQ->kout) != RC_OK) {
+            freeStrategyData(bm);
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+    }
+    if (bm->strategy == RS_LFU) {
+        BM_LFUParams *params = (BM_LFUParams *)stratData;
+        BM_LFUData *lfu;
+        int i;
+
+        lfu = (BM_LFUData *)malloc(sizeof(BM_LFUData));
+        if (lfu == NULL)
+            return RC_MEMORY_ALLOCATION_FAIL;
+        lfu->count = (int *)calloc(bm->numPages, sizeof(int));
+        lfu->bucketOf = (int *)malloc(bm->numPages * sizeof(int));
+        lfu->prev = (int *)malloc(bm->numPages * sizeof(int));
+        lfu->next = (int *)malloc(bm->numPages * sizeof(int));
+        lfu->bucketFreq = (int *)malloc(bm->numPages * sizeof(int));
+        lfu->bucketHead = (int *)malloc(bm->numPages * sizeof(int));
+        lfu->bucketTail = (int *)malloc(bm->numPages * sizeof(int));
+        lfu->bucketPrev = (int *)malloc(bm->numPages * sizeof(int));
+        lfu->bucketNext = (int *)malloc(bm->numPages * sizeof(int));
+        lfu->order = (int *)malloc(bm->numPages * sizeof(int));
+        bm->strategyData = lfu;
+        if (lfu->count == NULL || lfu->bucketOf == NULL || lfu->prev == NULL || lfu->next == NULL
+                || lfu->bucketFreq == NULL || lfu->bucketHead == NULL || lfu->bucketTail == NULL
+                || lfu->bucketPrev == NULL || lfu->bucketNext == NULL || lfu->order == NULL) {
+            freeStrategyData(bm);
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+        // every bucket starts unused, there are never more distinct frequencies than frames
+        for (i = 0; i < bm->numPages; i++) {
+            lfu->bucketNext[i] = (i + 1 < bm->numPages) ? i + 1 : -1;
+            lfu->bucketOf[i] = -1;
+        }
+        lfu->freeBuckets = 0;
+        lfu->lowest = -1;
+        lfu->agingPeriod = (params != NULL && params->agingPeriod > 0) ? params->agingPeriod : 0;
+        lfu->pinsSinceAging = 0;
+    }
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: freeStrategyData
+ *
+ * Description: release what initStrategyData allocated.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void freeStrategyData(BM_BufferPool *bm) {
+    if (bm->strategyData == NULL)
+        return;
+
+    if (bm->strategy == RS_FIFO || bm->strategy == RS_LRU)
+        freeFrameList((BM_ListData *)bm->strategyData);
+    if (bm->strategy == RS_ARC) {
+        BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+
+        freeFrameList(&(arc->t1));
+        freeFrameList(&(arc->t2));
+        freeFrameList(&(arc->b1));
+        freeFrameList(&(arc->b2));
+        freeGhostData(&(arc->ghosts));
+    }
+    if (bm->strategy == RS_2Q) {
+        BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+
+        freeFrameList(&(twoQ->a1in));
+        freeFrameList(&(twoQ->am));
+        freeFrameList(&(twoQ->a1out));
+        freeGhostData(&(twoQ->ghosts));
+    }
+    if (bm->strategy == RS_LRU_K) {
+        free(((BM_LRUKData *)bm->strategyData)->history);
+        free(((BM_LRUKData *)bm->strategyData)->last);
+    }
+    if (bm->strategy == RS_LFU) {
+        BM_LFUData *lfu = (BM_LFUData *)bm->strategyData;
+
+        free(lfu->count);
+        free(lfu->bucketOf);
+        free(lfu->prev);
+        free(lfu->next);
+        free(lfu->bucketFreq);
+        free(lfu->bucketHead);
+        free(lfu->bucketTail);
+        free(lfu->bucketPrev);
+        free(lfu->bucketNext);
+        free(lfu->order);
+    }
+    free(bm->strategyData);
+    bm->strategyData = NULL;
+}
+
+/***************************************************************
+ * Function Name: strategyClock
+ *
+ * Description: decide use which frame to save data using CLOCK (second chance). The hand skips pinned frames and clears the reference bit of frames used since it last passed, the first unpinned frame with a clear bit is the victim. Return -1 if every frame is pinned.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: int
+ *
+***************************************************************/
+
+int strategyClock(BM_BufferPool *bm) {
+    BM_ClockData *clock = (BM_ClockData *)bm->strategyData;
+    int victim = -1;
+    int i;
+
+    // two turns are enough: the first one clears every reference bit
+    for (i = 0; i < 2 * bm->numPages; ++i) {
+        int frame = clock->hand;
+
+        clock->hand = (clock->hand + 1) % bm->numPages;
+        if (!frameEvictable(bm, frame))
+            continue;
+        if (__atomic_fetch_and(&(bm->frameSync[frame].state), ~FRAME_REF, __ATOMIC_ACQ_REL) & FRAME_REF)
+            continue;
+        victim = frame;
+        break;
+    }
+    return victim;
+}
+
+/***************************************************************
+ * Function Name: strategyLRU_k
+ *
+ * Description: decide use which frame to save data using LRU-K. The victim is the unpinned frame with the largest backward K-distance, i.e. the oldest K-th most recent reference. Pages with fewer than K references have an infinite distance and go first, in LRU order. Frames referenced within the correlated reference period are only chosen if nothing else is left. Return -1 if every frame is pinned.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: int
+ *
+***************************************************************/
+
+int strategyLRU_k(BM_BufferPool *bm) {
+    BM_LRUKData *lruk = (BM_LRUKData *)bm->strategyData;
+    int victim = -1;
+    bool victimCorrelated = TRUE;
+    int i;
+
+    for (i = 0; i < bm->numPages; ++i) {
+        long *hist = lruk->history + (long)i * lruk->k;
+        long *best;
+        bool correlated;
+
+        if (!frameEvictable(bm, i))
+            continue;
+
+        // the pin that needs the frame happens at now + 1
+        correlated = (lruk->now + 1 - lruk->last[i] <= lruk->correlatedPeriod);
+        if (victim != -1) {
+            best = lruk->history + (long)victim * lruk->k;
+            if (correlated && !victimCorrelated)
+                continue;
+            if (correlated == victimCorrelated) {
+                if (hist[lruk->k - 1] > best[lruk->k - 1])
+                    continue;
+                if (hist[lruk->k - 1] == best[lruk->k - 1] && hist[0] >= best[0])
+                    continue;
+            }
+        }
+        victim = i;
+        victimCorrelated = correlated;
+    }
+    return victim;
+}
+
+/***************************************************************
+ * Function Name: lfuNewBucket
+ *
+ * Description: take an unused bucket for frequency freq and link it right after bucket after, or in front of all buckets if after is -1.
+ *
+ * Parameters: BM_LFUData *lfu, int after, int freq
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int lfuNewBucket(BM_LFUData *lfu, int after, int freq) {
+    int b = lfu->freeBuckets;
+    int following = (after == -1) ? lfu->lowest : lfu->bucketNext[after];
+
+    lfu->freeBuckets = lfu->bucketNext[b];
+    lfu->bucketFreq[b] = freq;
+    lfu->bucketHead[b] = -1;
+    lfu->bucketTail[b] = -1;
+    lfu->bucketPrev[b] = after;
+    lfu->bucketNext[b] = following;
+    if (following != -1)
+        lfu->bucketPrev[following] = b;
+    if (after == -1)
+        lfu->lowest = b;
+    else
+        lfu->bucketNext[after] = b;
+    return b;
+}
+
+/***************************************************************
+ * Function Name: lfuUnlinkFrame
+ *
+ * Description: take frame out of its bucket, it is then in no bucket (bucketOf is -1). A bucket left empty is unlinked and returned to the unused buckets.
+ *
+ * Parameters: BM_LFUData *lfu, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void lfuUnlinkFrame(BM_LFUData *lfu, int frame) {
+    int b = lfu->bucketOf[frame];
+
+    if (lfu->prev[frame] != -1)
+        lfu->next[lfu->prev[frame]] = lfu->next[frame];
+    else
+        lfu->bucketHead[b] = lfu->next[frame];
+    if (lfu->next[frame] != -1)
+        lfu->prev[lfu->next[frame]] = lfu->prev[frame];
+    else
+        lfu->bucketTail[b] = lfu->prev[frame];
+
+    if (lfu->bucketHead[b] == -1) {
+        if (lfu->bucketPrev[b] != -1)
+            lfu->bucketNext[lfu->bucketPrev[b]] = lfu->bucketNext[b];
+        else
+            lfu->lowest = lfu->bucketNext[b];
+        if (lfu->bucketNext[b] != -1)
+            lfu->bucketPrev[lfu->bucketNext[b]] = lfu->bucketPrev[b];
+        lfu->bucketNext[b] = lfu->freeBuckets;
+        lfu->freeBuckets = b;
+    }
+    lfu->bucketOf[frame] = -1;
+}
+
+/***************************************************************
+ * Function Name: lfuAppendFrame
+ *
+ * Description: put frame at the tail (most recently counted end) of bucket b.
+ *
+ * Parameters: BM_LFUData *lfu, int frame, int b
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void lfuAppendFrame(BM_LFUData *lfu, int frame, int b) {
+    lfu->bucketOf[frame] = b;
+    lfu->prev[frame] = lfu->bucketTail[b];
+    lfu->next[frame] = -1;
+    if (lfu->bucketTail[b] != -1)
+        lfu->next[lfu->bucketTail[b]] = frame;
+    else
+        lfu->bucketHead[b] = frame;
+    lfu->bucketTail[b] = frame;
+}
+
+/***************************************************************
+ * Function Name: lfuPrefetchFrame
+ *
+ * Description: put the frame of a prefetched page in the bucket of frequency 0, which is always the lowest one, so it goes before every page that was pinned. Its count stays 0 until the first pin.
+ *
+ * Parameters: BM_LFUData *lfu, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void lfuPrefetchFrame(BM_LFUData *lfu, int frame) {
+    int b = lfu->lowest;
+
+    if (b == -1 || lfu->bucketFreq[b] != 0)
+        b = lfuNewBucket(lfu, -1, 0);
+    lfuAppendFrame(lfu, frame, b);
+}
+
+/***************************************************************
+ * Function Name: lfuCountPin
+ *
+ * Description: count one pin of the page in frame. The frame moves to the bucket of the next frequency, which is either the neighbour of its current bucket or a new bucket linked right after it, so the cost does not depend on the pool size.
+ *
+ * Parameters: BM_LFUData *lfu, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void lfuCountPin(BM_LFUData *lfu, int frame) {
+    int from, to;
+
+    if (lfu->count[frame] == 0) {
+        // newly loaded page, or the first pin of a prefetched page waiting in the bucket of frequency 0
+        if (lfu->bucketOf[frame] != -1)
+            lfuUnlinkFrame(lfu, frame);
+        lfu->count[frame] = 1;
+        from = (lfu->lowest != -1 && lfu->bucketFreq[lfu->lowest] == 0) ? lfu->lowest : -1;
+        to = (from == -1) ? lfu->lowest : lfu->bucketNext[from];
+        if (to == -1 || lfu->bucketFreq[to] != 1)
+            to = lfuNewBucket(lfu, from, 1);
+        lfuAppendFrame(lfu, frame, to);
+        return;
+    }
+
+    from = lfu->bucketOf[frame];
+    lfu->count[frame]++;
+    to = lfu->bucketNext[from];
+    if (to == -1 || lfu->bucketFreq[to] != lfu->count[frame]) {
+        if (lfu->bucketHead[from] == frame && lfu->bucketTail[from] == frame) {
+            // the frame is alone, its bucket can simply take the new frequency
+            lfu->bucketFreq[from] = lfu->count[frame];
+            return;
+        }
+        to = lfuNewBucket(lfu, from, lfu->count[frame]);
+    }
+    lfuUnlinkFrame(lfu, frame);
+    lfuAppendFrame(lfu, frame, to);
+}
+
+/***************************************************************
+ * Function Name: lfuAge
+ *
+ * Description: halve every frequency so that old popularity decays. Halving keeps the order of the buckets, so they are rebuilt in one pass from the lowest frequency up; frames that end with the same frequency keep their relative order.
+ *
+ * Parameters: BM_LFUData *lfu, int numPages
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void lfuAge(BM_LFUData *lfu, int numPages) {
+    int n = 0;
+    int b, frame, i;
+
+    // collect the frames in increasing frequency
+    for (b = lfu->lowest; b != -1; b = lfu->bucketNext[b])
+        for (frame = lfu->bucketHead[b]; frame != -1; frame = lfu->next[frame])
+            lfu->order[n++] = frame;
+
+    for (b = 0; b < numPages; b++)
+        lfu->bucketNext[b] = (b + 1 < numPages) ? b + 1 : -1;
+    lfu->freeBuckets = 0;
+    lfu->lowest = -1;
+
+    b = -1;
+    for (i = 0; i < n; i++) {
+        frame = lfu->order[i];
+        lfu->count[frame] = (lfu->count[frame] > 1) ? lfu->count[frame] / 2 : lfu->count[frame];
+        if (b == -1 || lfu->bucketFreq[b] != lfu->count[frame])
+            b = lfuNewBucket(lfu, b, lfu->count[frame]);
+        lfuAppendFrame(lfu, frame, b);
+    }
+}
+
+/***************************************************************
+ * Function Name: strategyLFU
+ *
+ * Description: decide use which frame to save data using LFU. Buckets are visited from the lowest frequency up and, inside a bucket, from the frame counted least recently; the first unpinned frame is the victim. Return -1 if every frame is pinned.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: int
+ *
+***************************************************************/
+
+int strategyLFU(BM_BufferPool *bm) {
+    BM_LFUData *lfu = (BM_LFUData *)bm->strategyData;
+    int b, frame;
+
+    for (b = lfu->lowest; b != -1; b = lfu->bucketNext[b]) {
+        for (frame = lfu->bucketHead[b]; frame != -1; frame = lfu->next[frame]) {
+            if (framePins(bm, frame) == 0)
+                return frame;
+        }
+    }
+    return -1;
+}
+
+/***************************************************************
+ * Function Name: initFrameList
+ *
+ * Description: allocate an empty FIFO/LRU list over n frames (or ghost slots).
+ *
+ * Parameters: BM_ListData *list, int n
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC initFrameList(BM_ListData *list, int n) {
+    list->prev = (int *)malloc(n * sizeof(int));
+    list->next = (int *)malloc(n * sizeof(int));
+    list->linked = (bool *)calloc(n, sizeof(bool));
+    list->head = -1;
+    list->tail = -1;
+    list->length = 0;
+    if (list->prev == NULL || list->next == NULL || list->linked == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: freeFrameList
+ *
+ * Description: release what initFrameList allocated.
+ *
+ * Parameters: BM_ListData *list
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void freeFrameList(BM_ListData *list) {
+    free(list->prev);
+    free(list->next);
+    free(list->linked);
+    list->prev = NULL;
+    list->next = NULL;
+    list->linked = NULL;
+}
+
+/***************************************************************
+ * Function Name: listAppendFrame
+ *
+ * Description: link frame at the tail of a FIFO/LRU list, the end that is evicted last.
+ *
+ * Parameters: BM_ListData *list, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void listAppendFrame(BM_ListData *list, int frame) {
+    list->length++;
+    list->prev[frame] = list->tail;
+    list->next[frame] = -1;
+    if (list->tail != -1)
+        list->next[list->tail] = frame;
+    else
+        list->head = frame;
+    list->tail = frame;
+    list->linked[frame] = TRUE;
+}
+
+/***************************************************************
+ * Function Name: listPrependFrame
+ *
+ * Description: link frame at the head of a FIFO/LRU list, the end that is evicted first.
+ *
+ * Parameters: BM_ListData *list, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void listPrependFrame(BM_ListData *list, int frame) {
+    list->length++;
+    list->prev[frame] = -1;
+    list->next[frame] = list->head;
+    if (list->head != -1)
+        list->prev[list->head] = frame;
+    else
+        list->tail = frame;
+    list->head = frame;
+    list->linked[frame] = TRUE;
+}
+
+/***************************************************************
+ * Function Name: listUnlinkFrame
+ *
+ * Description: take frame out of a FIFO/LRU list.
+ *
+ * Parameters: BM_ListData *list, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void listUnlinkFrame(BM_ListData *list, int frame) {
+    if (list->prev[frame] != -1)
+        list->next[list->prev[frame]] = list->next[frame];
+    else
+        list->head = list->next[frame];
+    if (list->next[frame] != -1)
+        list->prev[list->next[frame]] = list->prev[frame];
+    else
+        list->tail = list->prev[frame];
+    list->linked[frame] = FALSE;
+    list->length--;
+}
+
+/***************************************************************
+ * Function Name: initGhostData
+ *
+ * Description: allocate n ghost slots, all unused.
+ *
+ * Parameters: BM_GhostData *ghosts, int n
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC initGhostData(BM_GhostData *ghosts, int n) {
+    int i;
+
+    ghosts->page = (PageNumber *)malloc(n * sizeof(PageNumber));
+    ghosts->freeSlots = (int *)malloc(n * sizeof(int));
+    if (ghosts->page == NULL || ghosts->freeSlots == NULL
+            || initPageTable(&(ghosts->table), n) != RC_OK)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    for (i = 0; i < n; i++)
+        ghosts->freeSlots[i] = n - 1 - i;
+    ghosts->numFreeSlots = n;
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: freeGhostData
+ *
+ * Description: release what initGhostData allocated.
+ *
+ * Parameters: BM_GhostData *ghosts
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void freeGhostData(BM_GhostData *ghosts) {
+    free(ghosts->page);
+    free(ghosts->freeSlots);
+    freePageTable(&(ghosts->table));
+    ghosts->page = NULL;
+    ghosts->freeSlots = NULL;
+}
+
+/***************************************************************
+ * Function Name: ghostForget
+ *
+ * Description: drop the ghost in slot from list and give the slot back.
+ *
+ * Parameters: BM_GhostData *ghosts, BM_ListData *list, int slot
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void ghostForget(BM_GhostData *ghosts, BM_ListData *list, int slot) {
+    listUnlinkFrame(list, slot);
+    pageTableRemove(&(ghosts->table), ghosts->page[slot]);
+    ghosts->freeSlots[(ghosts->numFreeSlots)++] = slot;
+}
+
+/***************************************************************
+ * Function Name: ghostRemember
+ *
+ * Description: remember pageNum at the MRU end of list. The caller makes sure a slot is free.
+ *
+ * Parameters: BM_GhostData *ghosts, BM_ListData *list, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void ghostRemember(BM_GhostData *ghosts, BM_ListData *list, PageNumber pageNum) {
+    int slot = ghosts->freeSlots[--(ghosts->numFreeSlots)];
+
+    ghosts->page[slot] = pageNum;
+    pageTableInsert(&(ghosts->table), pageNum, slot);
+    listAppendFrame(list, slot);
+}
+
+/***************************************************************
+ * Function Name: arcNoteMiss
+ *
+ * Description: ARC bookkeeping for a page that is not in the pool, done before a frame is chosen for it. A ghost hit in b1 means t1 was too small and raises the target size of t1, a ghost hit in b2 lowers it. A page that is no ghost may have to push the oldest ghost out so the directory stays within twice the pool size. The ghosts themselves are only changed by arcCommitMiss once a frame was taken, arcCancelMiss undoes the rest.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void arcNoteMiss(BM_BufferPool *bm, PageNumber pageNum) {
+    BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+    int c = bm->numPages;
+    int slot, delta;
+
+    arc->missInB1 = FALSE;
+    arc->missInB2 = FALSE;
+    arc->dropFromT1 = FALSE;
+    arc->missTarget = arc->target;
+    arc->trimGhosts = 0;
+
+    slot = pageTableLookup(&(arc->ghosts.table), pageNum);
+    if (slot != -1 && arc->b1.linked[slot]) {
+        delta = (arc->b2.length > arc->b1.length) ? arc->b2.length / arc->b1.length : 1;
+        arc->target = (arc->target + delta < c) ? arc->target + delta : c;
+        arc->missInB1 = TRUE;
+        return;
+    }
+    if (slot != -1) {
+        delta = (arc->b1.length > arc->b2.length) ? arc->b1.length / arc->b2.length : 1;
+        arc->target = (arc->target - delta > 0) ? arc->target - delta : 0;
+        arc->missInB2 = TRUE;
+        return;
+    }
+
+    if (arc->t1.length + arc->b1.length >= c) {
+        if (arc->b1.length > 0)
+            arc->trimGhosts = 1;
+        else
+            arc->dropFromT1 = TRUE;
+    } else if (arc->t1.length + arc->t2.length + arc->b1.length + arc->b2.length >= 2 * c
+               && arc->b2.length > 0) {
+        arc->trimGhosts = 2;
+    }
+}
+
+/***************************************************************
+ * Function Name: arcCommitMiss
+ *
+ * Description: second half of arcNoteMiss, once a frame was taken for pageNum: forget its ghost, unless evicting the victim already pushed that ghost out, or the oldest ghost arcNoteMiss chose to drop. missInB1 and missInB2 stay set for updataAttribute.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void arcCommitMiss(BM_BufferPool *bm, PageNumber pageNum) {
+    BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+    int slot;
+
+    slot = pageTableLookup(&(arc->ghosts.table), pageNum);
+    if (slot != -1)
+        ghostForget(&(arc->ghosts), arc->b1.linked[slot] ? &(arc->b1) : &(arc->b2), slot);
+    else if (arc->trimGhosts == 1 && arc->b1.length > 0)
+        ghostForget(&(arc->ghosts), &(arc->b1), arc->b1.head);
+    else if (arc->trimGhosts == 2 && arc->b2.length > 0)
+        ghostForget(&(arc->ghosts), &(arc->b2), arc->b2.head);
+    arc->missTarget = arc->target;
+    arc->trimGhosts = 0;
+}
+
+/***************************************************************
+ * Function Name: arcCancelMiss
+ *
+ * Description: undo arcNoteMiss for a miss that found no frame, or end a miss after updataAttribute: restore the target size it had before the miss unless committed, and clear the flags so the next miss or restoreVictim does not see them.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void arcCancelMiss(BM_BufferPool *bm) {
+    BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+
+    arc->target = arc->missTarget;
+    arc->missInB1 = FALSE;
+    arc->missInB2 = FALSE;
+    arc->dropFromT1 = FALSE;
+    arc->trimGhosts = 0;
+}
+
+/***************************************************************
+ * Function Name: strategyARC
+ *
+ * Description: decide use which frame to save data using ARC. The LRU page of t1 is evicted while t1 is above its target size, otherwise the LRU page of t2; pinned frames are stepped over and the other list is used if one has no unpinned frame. evictAttribute remembers the evicted page in b1 or b2. Return -1 if every frame is pinned.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: int
+ *
+***************************************************************/
+
+int strategyARC(BM_BufferPool *bm) {
+    BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+    BM_ListData *first, *second, *from;
+    int frame = -1;
+
+    if (arc->t1.length > 0 && (arc->t1.length > arc->target
+                               || (arc->missInB2 && arc->t1.length == arc->target)
+                               || arc->dropFromT1)) {
+        first = &(arc->t1);
+        second = &(arc->t2);
+    } else {
+        first = &(arc->t2);
+        second = &(arc->t1);
+    }
+
+    for (from = first; from != NULL; from = (from == first) ? second : NULL) {
+        for (frame = from->head; frame != -1; frame = from->next[frame])
+            if (framePins(bm, frame) == 0)
+                break;
+        if (frame != -1)
+            break;
+    }
+    return frame;
+}
+
+/***************************************************************
+ * Function Name: twoQNoteMiss
+ *
+ * Description: 2Q bookkeeping for a page that is not in the pool, done before a frame is chosen for it. A page still remembered by a1out was used again after a full trip through a1in, so it will be loaded into am. The ghost stays in a1out until twoQCommitMiss, so a miss that finds no frame only has to clear missInA1out.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void twoQNoteMiss(BM_BufferPool *bm, PageNumber pageNum) {
+    BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+
+    twoQ->missInA1out = (pageTableLookup(&(twoQ->ghosts.table), pageNum) != -1);
+}
+
+/***************************************************************
+ * Function Name: twoQCommitMiss
+ *
+ * Description: second half of twoQNoteMiss, once a frame was taken for pageNum: forget its a1out ghost, unless evicting the victim already pushed it out. missInA1out stays set for updataAttribute.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void twoQCommitMiss(BM_BufferPool *bm, PageNumber pageNum) {
+    BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+    int slot;
+
+    slot = pageTableLookup(&(twoQ->ghosts.table), pageNum);
+    if (slot != -1)
+        ghostForget(&(twoQ->ghosts), &(twoQ->a1out), slot);
+}
+
+/***************************************************************
+ * Function Name: strategy2Q
+ *
+ * Description: decide use which frame to save data using 2Q. While a1in holds more than kin frames its oldest page is evicted (evictAttribute remembers it in a1out), otherwise the LRU page of am is evicted and forgotten. Pinned frames are stepped over and the other queue is used if one has no unpinned frame. Return -1 if every frame is pinned.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: int
+ *
+***************************************************************/
+
+int strategy2Q(BM_BufferPool *bm) {
+    BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+    BM_ListData *first, *second, *from;
+    int frame = -1;
+
+    if (twoQ->a1in.length > twoQ->kin) {
+        first = &(twoQ->a1in);
+        second = &(twoQ->am);
+    } else {
+        first = &(twoQ->am);
+        second = &(twoQ->a1in);
+    }
+
+    for (from = first; from != NULL; from = (from == first) ? second : NULL) {
+        for (frame = from->head; frame != -1; frame = from->next[frame])
+            if (framePins(bm, frame) == 0)
+                break;
+        if (frame != -1)
+            break;
+    }
+    return frame;
+}
+
+/***************************************************************
+ * Function Name: chooseVictim
+ *
+ * Description: ask the replacement strategy which frame it would evict. The lists and counts of the strategy are not changed until evictAttribute is called for the frame. CLOCK is the exception: its hand clears the reference bits of the frames it passes and stays behind the victim, even if the caller keeps the page. Return -1 if every frame is pinned, -2 for an unknown strategy.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int chooseVictim(BM_BufferPool *bm) {
+    switch (bm->strategy)
+    {
+    case RS_FIFO:
+    case RS_LRU:
+        return strategyFIFOandLRU(bm);
+    case RS_CLOCK:
+        return strategyClock(bm);
+    case RS_LRU_K:
+        return strategyLRU_k(bm);
+    case RS_LFU:
+        return strategyLFU(bm);
+    case RS_ARC:
+        return strategyARC(bm);
+    case RS_2Q:
+        return strategy2Q(bm);
+    default:
+        return -2;
+    }
+}
+
+/***************************************************************
+ * Function Name: frameInWindow
+ *
+ * Description: whether frame is one of the admission window frames, which the strategy does not manage.
+ *
+ * Parameters: BM_BufferPool *bm, int frame
+ *
+ * Return: bool
+ *
+***************************************************************/
+
+static bool frameInWindow(BM_BufferPool *bm, int frame) {
+    return bm->admission != NULL && bm->admission->inWindow[frame];
+}
+
+/***************************************************************
+ * Function Name: frameEvictable
+ *
+ * Description: whether the strategy may choose frame: it is unpinned and not an admission window frame.
+ *
+ * Parameters: BM_BufferPool *bm, int frame
+ *
+ * Return: bool
+ *
+***************************************************************/
+
+static bool frameEvictable(BM_BufferPool *bm, int frame) {
+    return framePins(bm, frame) == 0 && !frameInWindow(bm, frame);
+}
+
+/***************************************************************
+ * Function Name: initAdmission
+ *
+ * Description: set up the TinyLFU admission filter. The last admissionWindowPercent of the frames (at least one) become window frames and are taken out of the free frames of the strategy. The sketch has four times as many counters per row as frames and is halved after ten pins per frame.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+RC initAdmission(BM_BufferPool *bm) {
+    BM_AdmissionData *admission;
+    int percent = (bm->options.admissionWindowPercent > 0) ? bm->options.admissionWindowPercent : 1;
+    int numWindow = bm->numPages * percent / 100;
+    int numMain;
+    int i;
+
+    if (numWindow < 1)
+        numWindow = 1;
+    if (numWindow >= bm->numPages)
+        return RC_OK; // a single frame leaves nothing to filter
+    numMain = bm->numPages - numWindow;
+
+    admission = (BM_AdmissionData *)calloc(1, sizeof(BM_AdmissionData));
+    if (admission == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    bm->admission = admission;
+
+    admission->width = 64;
+    while (admission->width < 4 * bm->numPages)
+        admission->width <<= 1;
+    admission->sampleSize = 10 * bm->numPages;
+    admission->sketch = (unsigned char *)calloc((long)ADMISSION_SKETCH_DEPTH * admission->width, sizeof(unsigned char));
+    admission->inWindow = (bool *)calloc(bm->numPages, sizeof(bool));
+    admission->freeWindow = (int *)malloc(numWindow * sizeof(int));
+    if (admission->sketch == NULL || admission->inWindow == NULL || admission->freeWindow == NULL
+            || initFrameList(&(admission->window), bm->numPages) != RC_OK) {
+        freeAdmission(bm);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+
+    for (i = 0; i < numWindow; i++) {
+        admission->freeWindow[i] = bm->numPages - 1 - i;
+        admission->inWindow[bm->numPages - 1 - i] = TRUE;
+    }
+    admission->numFreeWindow = numWindow;
+    for (i = 0; i < numMain; i++)
+        bm->freeFrames[i] = numMain - 1 - i;
+    bm->numFreeFrames = numMain;
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: freeAdmission
+ *
+ * Description: release what initAdmission allocated.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void freeAdmission(BM_BufferPool *bm) {
+    if (bm->admission == NULL)
+        return;
+    free(bm->admission->sketch);
+    free(bm->admission->inWindow);
+    free(bm->admission->freeWindow);
+    freeFrameList(&(bm->admission->window));
+    free(bm->admission);
+    bm->admission = NULL;
+}
+
+/***************************************************************
+ * Function Name: admissionSlot
+ *
+ * Description: counter of pageNum in sketch row, each row hashes with its own seed.
+ *
+ * Parameters: BM_AdmissionData *admission, PageNumber pageNum, int row
+ *
+ * Return: unsigned char *
+ *
+***************************************************************/
+
+static unsigned char *admissionSlot(BM_AdmissionData *admission, PageNumber pageNum, int row) {
+    unsigned long long h = ((unsigned long long)pageNum + 1) * (0x9E3779B97F4A7C15ULL + 2 * row);
+
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return admission->sketch + (long)row * admission->width + (long)(h & (admission->width - 1));
+}
+
+/***************************************************************
+ * Function Name: admissionRecord
+ *
+ * Description: count one pin of pageNum. Only the smallest counters are raised (conservative update), which keeps the estimate of rare pages low. After sampleSize pins every counter is halved.
+ *
+ * Parameters: BM_AdmissionData *admission, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+void admissionRecord(BM_AdmissionData *admission, PageNumber pageNum) {
+    int estimate = admissionEstimate(admission, pageNum);
+    long i;
+    int row;
+
+    if (estimate < 15) {
+        for (row = 0; row < ADMISSION_SKETCH_DEPTH; row++) {
+            unsigned char *counter = admissionSlot(admission, pageNum, row);
+            if (*counter == estimate)
+                (*counter)++;
+        }
+    }
+
+    if (++(admission->additions) >= admission->sampleSize) {
+        for (i = 0; i < (long)ADMISSION_SKETCH_DEPTH * admission->width; i++)
+            admission->sketch[i] >>= 1;
+        admission->additions /= 2;
+    }
+}
+
+/***************************************************************
+ * Function Name: admissionEstimate
+ *
+ * Description: estimated number of recent pins of pageNum, the smallest of its counters.
+ *
+ * Parameters: BM_AdmissionData *admission, PageNumber pageNum
+ *
+ * Return: int
+ *
+***************************************************************/
+
+int admissionEstimate(BM_AdmissionData *admission, PageNumber pageNum) {
+    int estimate = 15;
+    int row;
+
+    for (row = 0; row < ADMISSION_SKETCH_DEPTH; row++) {
+        unsigned char *counter = admissionSlot(admission, pageNum, row);
+        if (*counter < estimate)
+            estimate = *counter;
+    }
+    return estimate;
+}
+
+/***************************************************************
+ * Function Name: admissionWindowVictim
+ *
+ * Description: frame for a page the filter did not admit: an empty window frame, or else the oldest unpinned one. Nothing changes until admissionTakeWindowFrame. Return -1 if every window frame is pinned.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int admissionWindowVictim(BM_BufferPool *bm) {
+    BM_AdmissionData *admission = bm->admission;
+    int frame;
+
+    if (admission->numFreeWindow > 0)
+        return admission->freeWindow[admission->numFreeWindow - 1];
+    for (frame = admission->window.head; frame != -1; frame = admission->window.next[frame])
+        if (framePins(bm, frame) == 0)
+            return frame;
+    return -1;
+}
+
+/***************************************************************
+ * Function Name: admissionTakeWindowFrame
+ *
+ * Description: use the window frame chosen by admissionWindowVictim and move it to the young end of the window.
+ *
+ * Parameters: BM_BufferPool *bm, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void admissionTakeWindowFrame(BM_BufferPool *bm, int frame) {
+    BM_AdmissionData *admission = bm->admission;
+
+    if (admission->numFreeWindow > 0 && admission->freeWindow[admission->numFreeWindow - 1] == frame)
+        admission->numFreeWindow--;
+    else
+        listUnlinkFrame(&(admission->window), frame);
+    listAppendFrame(&(admission->window), frame);
+}
+
+/***************************************************************
+ * Function Name: initPoolLatches
+ *
+ * Description: set up the page table shards and the per-frame latches. Small pools get fewer shards, each shard starts with room for its share of the frames and grows when pages cluster in it.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC initPoolLatches(BM_BufferPool *bm) {
+    int i;
+
+    bm->numShards = 1;
+    while (bm->numShards < PAGE_TABLE_MAX_SHARDS && bm->numShards * 2 <= bm->numPages)
+        bm->numShards <<= 1;
+
+    bm->pageTable = (BM_PageTableShard *)calloc(bm->numShards, sizeof(BM_PageTableShard));
+    bm->frameSync = (BM_FrameSync *)calloc(bm->numPages, sizeof(BM_FrameSync));
+    if (bm->pageTable == NULL || bm->frameSync == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    for (i = 0; i < bm->numShards; i++) {
+        pthread_mutex_init(&(bm->pageTable[i].latch), NULL);
+        pthread_cond_init(&(bm->pageTable[i].ioDone), NULL);
+    }
+    for (i = 0; i < bm->numPages; i++)
+        pthread_rwlock_init(&(bm->frameSync[i].latch), NULL);
+    for (i = 0; i < bm->numShards; i++) {
+        if (initPageTable(&(bm->pageTable[i].table), bm->numPages / bm->numShards + 1) != RC_OK)
+            return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: freePoolResources
+ *
+ * Description: release everything initBufferPoolWithOptions set up, including the partitions, and close the page file. Parts that were never allocated are NULL and skipped.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void freePoolResources(BM_BufferPool *bm) {
+    int i;
+
+    stopPrefetcher(bm);
+    stopFlusher(bm);
+    if (bm->partitions != NULL) {
+        for (i = 0; i < bm->numPartitions; i++)
+            freePoolResources(bm->partitions + i);
+        free(bm->partitions);
+        bm->partitions = NULL;
+    }
+    freeAdmission(bm);
+    freeStrategyData(bm);
+    free(bm->freeFrames);
+    free(bm->hitBuffer);
+    if (bm->pageTable != NULL) {
+        for (i = 0; i < bm->numShards; i++) {
+            freePageTable(&(bm->pageTable[i].table));
+            pthread_mutex_destroy(&(bm->pageTable[i].latch));
+            pthread_cond_destroy(&(bm->pageTable[i].ioDone));
+        }
+        free(bm->pageTable);
+    }
+    if (bm->frameSync != NULL) {
+        for (i = 0; i < bm->numPages; i++)
+            pthread_rwlock_destroy(&(bm->frameSync[i].latch));
+        free(bm->frameSync);
+    }
+    freePagesBuffer(bm);
+    free(bm->mgmtData);
+    pthread_mutex_destroy(&(bm->strategyLatch));
+    pthread_mutex_destroy(&(bm->fileLatch));
+    if (bm->filePool == bm)
+        closePageFile(&(bm->fileHandle));
+}
+
+/***************************************************************
+ * Function Name: pageShard
+ *
+ * Description: the page table shard of pageNum. It hashes with another multiplier than the slots inside a shard, so the pages of one shard still spread over its slots.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum
+ *
+ * Return: BM_PageTableShard *
+ *
+***************************************************************/
+
+static BM_PageTableShard *pageShard(BM_BufferPool *bm, PageNumber pageNum) {
+    unsigned int h = pageHashKey(pageNum) * 2246822519u;
+    return bm->pageTable + ((h >> 16) & (unsigned int)(bm->numShards - 1));
+}
+
+/***************************************************************
+ * Function Name: partitionOf
+ *
+ * Description: the partition that caches pageNum, or bm itself if the pool is not partitioned. It hashes with a third multiplier, so the pages of one partition still spread over its shards and slots.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum
+ *
+ * Return: BM_BufferPool *
+ *
+***************************************************************/
+
+static BM_BufferPool *partitionOf(BM_BufferPool *bm, PageNumber pageNum) {
+    unsigned int h = pageHashKey(pageNum) * 3266489917u;
+
+    if (bm->partitions == NULL)
+        return bm;
+    // map the hash onto the partitions by its high bits, the count need not be a power of two
+    return bm->partitions + (int)(((unsigned long long)h * (unsigned int)bm->numPartitions) >> 32);
+}
+
+/***************************************************************
+ * Function Name: partitionOfFrame
+ *
+ * Description: the partition holding frame i of the pool, frames are numbered through the partitions in order. frame is set to the index inside that partition.
+ *
+ * Parameters: BM_BufferPool *bm, int i, int *frame
+ *
+ * Return: BM_BufferPool *
+ *
+***************************************************************/
+
+static BM_BufferPool *partitionOfFrame(BM_BufferPool *bm, int i, int *frame) {
+    int base, larger;
+
+    *frame = i;
+    if (bm->partitions == NULL)
+        return bm;
+    base = bm->numPages / bm->numPartitions;
+    larger = bm->numPages % bm->numPartitions;
+    if (i < larger * (base + 1)) {
+        *frame = i % (base + 1);
+        return bm->partitions + i / (base + 1);
+    }
+    i -= larger * (base + 1);
+    *frame = i % base;
+    return bm->partitions + larger + i / base;
+}
+
+/***************************************************************
+ * Function Name: pinnedFrame
+ *
+ * Description: frame of the page a handle was pinned to, or -1 if the page is not in the pool. The frame behind page->data is tried first, it needs no lookup while the caller holds its pin.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PageHandle *page
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int pinnedFrame(BM_BufferPool *bm, BM_PageHandle *page) {
+    BM_PageTableShard *shard;
+    unsigned long state;
+    long offset;
+    int pnum;
+
+    offset = (long)((unsigned long)page->data - (unsigned long)bm->frameArena);
+    if (bm->frameArena != NULL && page->data != NULL && offset >= 0 && offset < (long)bm->numPages * PAGE_SIZE) {
+        pnum = (int)(offset / PAGE_SIZE);
+        state = frameState(bm, pnum);
+        if ((state & FRAME_PIN_MASK) > 0 && !(state & FRAME_BUSY)
+                && __atomic_load_n(&((bm->mgmtData + pnum)->pageNum), __ATOMIC_ACQUIRE) == page->pageNum
+                && frameState(bm, pnum) == state)
+            return pnum;
+    }
+
+    shard = pageShard(bm, page->pageNum);
+    pthread_mutex_lock(&(shard->latch));
+    pnum = pageTableLookup(&(shard->table), page->pageNum);
+    pthread_mutex_unlock(&(shard->latch));
+    return pnum;
+}
+
+/***************************************************************
+ * Function Name: readFrame
+ *
+ * Description: read pageNum into a frame, growing the file first if the page is past its end. Only the size check holds the file latch, the read itself runs on a copy of the file handle. Partitions go through the file of the pool they belong to.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum, char *data
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC readFrame(BM_BufferPool *bm, PageNumber pageNum, char *data) {
+    BM_BufferPool *file = bm->filePool;
+    SM_FileHandle fileHandle;
+    RC RC_flag;
+
+    // pages past the end of the file are created empty, as the assignment asks.
+    pthread_mutex_lock(&(file->fileLatch));
+    RC_flag = ensureCapacity(pageNum + 1, &(file->fileHandle));
+    fileHandle = file->fileHandle;
+    pthread_mutex_unlock(&(file->fileLatch));
+
+    if (RC_flag == RC_OK)
+        RC_flag = readBlock(pageNum, &fileHandle, data);
+    if (RC_flag == RC_OK)
+        __atomic_add_fetch(&(file->numReadIO), 1, __ATOMIC_RELAXED);
+    return RC_flag;
+}
+
+/***************************************************************
+ * Function Name: readMappedFrame
+ *
+ * Description: load pageNum into a frame of a read-only pool by pointing the frame at the page inside the mapping of the file, without a copy. Counts as one read I/O. Pages past the mapping do not exist for a read-only pool.
+ *
+ * Parameters: BM_BufferPool *bm, int frame, PageNumber pageNum
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC readMappedFrame(BM_BufferPool *bm, int frame, PageNumber pageNum) {
+    char *data = getMappedPage(&(bm->filePool->fileHandle), pageNum);
+
+    if (data == NULL)
+        return RC_READ_NON_EXISTING_PAGE;
+    (bm->mgmtData + frame)->data = data;
+    __atomic_add_fetch(&(bm->filePool->numReadIO), 1, __ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: writeFrame
+ *
+ * Description: write a frame to pageNum without holding the file latch during the write.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum, char *data
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC writeFrame(BM_BufferPool *bm, PageNumber pageNum, char *data) {
+    BM_BufferPool *file = bm->filePool;
+    SM_FileHandle fileHandle;
+    RC RC_flag;
+
+    pthread_mutex_lock(&(file->fileLatch));
+    fileHandle = file->fileHandle;
+    pthread_mutex_unlock(&(file->fileLatch));
+
+    RC_flag = writeBlock(pageNum, &fileHandle, data);
+    if (RC_flag != RC_OK)
+        return RC_flag;
+    __atomic_add_fetch(&(file->numWriteIO), 1, __ATOMIC_RELAXED);
+
+    // a write past the end grew the file
+    pthread_mutex_lock(&(file->fileLatch));
+    if (fileHandle.totalNumPages > file->fileHandle.totalNumPages)
+        file->fileHandle.totalNumPages = fileHandle.totalNumPages;
+    pthread_mutex_unlock(&(file->fileLatch));
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: writeFrames
+ *
+ * Description: write numPages frames, data[i] to page pageNums[i], with one writePages call: one batch through the io_uring backend, else one vectored write per run of consecutive pages. results gets the outcome of each page, every page written counts as one write I/O.
+ *
+ * Parameters: BM_BufferPool *bm, const PageNumber *pageNums, int numPages, char **data, RC *results
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC writeFrames(BM_BufferPool *bm, const PageNumber *pageNums, int numPages, char **data, RC *results) {
+    BM_BufferPool *file = bm->filePool;
+    SM_FileHandle fileHandle;
+    RC RC_flag;
+    int i, written;
+
+    pthread_mutex_lock(&(file->fileLatch));
+    fileHandle = file->fileHandle;
+    pthread_mutex_unlock(&(file->fileLatch));
+
+    RC_flag = writePages(pageNums, numPages, &fileHandle, data, results);
+    written = 0;
+    for (i = 0; i < numPages; i++)
+        if (results[i] == RC_OK)
+            written++;
+    __atomic_add_fetch(&(file->numWriteIO), written, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&(file->fileLatch));
+    if (fileHandle.totalNumPages > file->fileHandle.totalNumPages)
+        file->fileHandle.totalNumPages = fileHandle.totalNumPages;
+    pthread_mutex_unlock(&(file->fileLatch));
+    return RC_flag;
+}
+
+/***************************************************************
+ * Function Name: readFrames
+ *
+ * Description: read numPages pages into frames, page pageNums[i] into data[i], with one readPages call: one batch through the io_uring backend, else one vectored read per run of consecutive pages. The pages must already be in the file. results gets the outcome of each page; every page read counts as one read I/O, or as one prefetch I/O for a read-ahead.
+ *
+ * Parameters: BM_BufferPool *bm, const PageNumber *pageNums, int numPages, char **data, RC *results, bool prefetch
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC readFrames(BM_BufferPool *bm, const PageNumber *pageNums, int numPages, char **data, RC *results, bool prefetch) {
+    BM_BufferPool *file = bm->filePool;
+    SM_FileHandle fileHandle;
+    RC RC_flag;
+    int i, read;
+
+    pthread_mutex_lock(&(file->fileLatch));
+    fileHandle = file->fileHandle;
+    pthread_mutex_unlock(&(file->fileLatch));
+
+    RC_flag = readPages(pageNums, numPages, &fileHandle, data, results);
+    read = 0;
+    for (i = 0; i < numPages; i++)
+        if (results[i] == RC_OK)
+            read++;
+    if (prefetch)
+        __atomic_add_fetch(&(file->numPrefetchIO), read, __ATOMIC_RELAXED);
+    else
+        __atomic_add_fetch(&(file->numReadIO), read, __ATOMIC_RELAXED);
+    return RC_flag;
+}
+
+/***************************************************************
+ * Function Name: readAheadAfter
+ *
+ * Description: called after every pin of a pool with options.readAheadPages. The pool follows up to READ_AHEAD_STREAMS sequential scans at once, each known by the page it pins next, so interleaved scans keep their read-ahead. A pin that continues a scan moves it on; once it gets within half a window of the pages read for that scan, the next window is read ahead. Any other pin may start a scan: it takes the place of a stream that never read ahead, else of the streams in turn. Only the thread that moves the end of a stream reads its new pages.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void readAheadAfter(BM_BufferPool *bm, PageNumber pageNum) {
+    int window = bm->options.readAheadPages;
+    BM_ReadAheadStream *stream = NULL;
+    PageNumber expected, end, first, last;
+    int i, slot;
+
+    for (i = 0; i < READ_AHEAD_STREAMS && stream == NULL; i++) {
+        expected = pageNum;
+        if (__atomic_compare_exchange_n(&(bm->streams[i].next), &expected, pageNum + 1, FALSE,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            stream = bm->streams + i;
+    }
+    if (stream == NULL) {
+        // random pins replace each other and leave the scans that read ahead alone
+        slot = __atomic_fetch_add(&(bm->nextStream), 1, __ATOMIC_RELAXED) % READ_AHEAD_STREAMS;
+        for (i = 0; i < READ_AHEAD_STREAMS; i++) {
+            if (__atomic_load_n(&(bm->streams[(slot + i) % READ_AHEAD_STREAMS].end), __ATOMIC_ACQUIRE) == NO_PAGE) {
+                slot = (slot + i) % READ_AHEAD_STREAMS;
+                break;
+            }
+        }
+        __atomic_store_n(&(bm->streams[slot].end), NO_PAGE, __ATOMIC_RELEASE);
+        __atomic_store_n(&(bm->streams[slot].next), pageNum + 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    end = __atomic_load_n(&(stream->end), __ATOMIC_ACQUIRE);
+    if (end >= pageNum + window / 2 && end <= pageNum + window)
+        return;
+    first = (end > pageNum && end <= pageNum + window) ? end + 1 : pageNum + 1;
+    last = pageNum + window;
+
+    // pages past the end of the file are not read ahead, a pin would create them
+    pthread_mutex_lock(&(bm->fileLatch));
+    if (last > bm->fileHandle.totalNumPages - 1)
+        last = bm->fileHandle.totalNumPages - 1;
+    pthread_mutex_unlock(&(bm->fileLatch));
+    if (first > last)
+        return;
+
+    if (__atomic_compare_exchange_n(&(stream->end), &end, last, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        readAhead(bm, first, last);
+}
+
+/***************************************************************
+ * Function Name: readAhead
+ *
+ * Description: load the pages first..last that are not in the pool yet into free or clean frames of their partitions, without pinning them. The pages are read with one readFrames call. It stops at the first page that would need a dirty or pinned victim.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber first, PageNumber last
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void readAhead(BM_BufferPool *bm, PageNumber first, PageNumber last) {
+    BM_BufferPool **parts;
+    PageNumber *pages;
+    PageNumber pageNum, victimPage;
+    char **data;
+    RC *results;
+    bool victimDirty;
+    int *frames;
+    int n, i, pnum;
+
+    parts = (BM_BufferPool **)malloc((last - first + 1) * sizeof(BM_BufferPool *));
+    pages = (PageNumber *)malloc((last - first + 1) * sizeof(PageNumber));
+    frames = (int *)malloc((last - first + 1) * sizeof(int));
+    data = (char **)malloc((last - first + 1) * sizeof(char *));
+    results = (RC *)malloc((last - first + 1) * sizeof(RC));
+    if (parts == NULL || pages == NULL || frames == NULL || data == NULL || results == NULL) {
+        free(parts);
+        free(pages);
+        free(frames);
+        free(data);
+        free(results);
+        return;
+    }
+
+    n = 0;
+    for (pageNum = first; pageNum <= last; pageNum++) {
+        parts[n] = partitionOf(bm, pageNum);
+        if (mapFrame(parts[n], pageNum, TRUE, &pnum, &victimPage, &victimDirty) != RC_OK)
+            break;
+        if (pnum == -1)
+            continue;
+        pages[n] = pageNum;
+        frames[n] = pnum;
+        data[n] = (parts[n]->mgmtData + pnum)->data;
+        n++;
+    }
+
+    if (n > 0)
+        readFrames(bm, pages, n, data, results, TRUE);
+    for (i = 0; i < n; i++) {
+        if (finishLoad(parts[i], frames[i], pages[i], results[i], TRUE) == RC_OK)
+            unpinFrame(parts[i], frames[i]);
+    }
+    free(parts);
+    free(pages);
+    free(frames);
+    free(data);
+    free(results);
+}
+
+/***************************************************************
+ * Function Name: pinResidentPage
+ *
+ * Description: pin pageNum if it is in the pool and return its frame, else return -1. A hit first tries pinFrameOptimistic, which takes no latch; only a page that is being read or written back takes the shard latch and waits for that I/O instead of starting another one. A frame whose pin count is full waits for an unpin. The strategy sees the hit through recordHit.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int pinResidentPage(BM_BufferPool *bm, PageNumber pageNum) {
+    BM_PageTableShard *shard = pageShard(bm, pageNum);
+    unsigned long state;
+    bool firstPin;
+    int pnum;
+
+    pnum = pinFrameOptimistic(bm, shard, pageNum);
+    while (pnum == -1)
+    {
+        pthread_mutex_lock(&(shard->latch));
+        while ((pnum = pageTableLookup(&(shard->table), pageNum)) != -1 && (frameState(bm, pnum) & FRAME_BUSY))
+            pthread_cond_wait(&(shard->ioDone), &(shard->latch));
+        // nothing can evict the frame while the shard latch is held, only pins can race
+        state = 0;
+        if (pnum != -1) {
+            state = frameState(bm, pnum);
+            while ((state & FRAME_PIN_MASK) != FRAME_PIN_MASK
+                    && !__atomic_compare_exchange_n(&(bm->frameSync[pnum].state), &state, state + 1,
+                                                    TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                ;
+        }
+        pthread_mutex_unlock(&(shard->latch));
+        if (pnum == -1)
+            return -1;
+        if ((state & FRAME_PIN_MASK) == FRAME_PIN_MASK) {
+            pnum = -1;
+            sched_yield();
+            continue;
+        }
+        if (bm->strategy == RS_CLOCK)
+            __atomic_fetch_or(&(bm->frameSync[pnum].state), FRAME_REF, __ATOMIC_ACQ_REL);
+    }
+
+    // only the first pin after a read-ahead clears the flag, it is the first reference of the page
+    firstPin = FALSE;
+    if ((frameState(bm, pnum) & FRAME_PREFETCHED)
+            && (__atomic_fetch_and(&(bm->frameSync[pnum].state), ~FRAME_PREFETCHED, __ATOMIC_ACQ_REL) & FRAME_PREFETCHED)) {
+        __atomic_add_fetch(&(bm->filePool->numPrefetchHits), 1, __ATOMIC_RELAXED);
+        firstPin = TRUE;
+    }
+
+    if (bm->admission != NULL || (strategyTracksHits(bm) && !frameInWindow(bm, pnum)))
+        recordHit(bm, pnum, pageNum, firstPin);
+    return pnum;
+}
+
+/***************************************************************
+ * Function Name: recordHit
+ *
+ * Description: let the admission filter and the strategy see a hit on a frame the caller has pinned. If another thread holds the strategy latch, the hit is left in hitBuffer for the next holder instead of waiting (see applyHits), so hits of LRU-K, LFU, ARC and 2Q only wait when the buffer is full. The first pin of a prefetched page always waits for the latch, it moves the frame out of the prefetched position (see prefetchHitAttribute).
+ *
+ * Parameters: BM_BufferPool *bm, int frame, PageNumber pageNum, bool firstPin
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void recordHit(BM_BufferPool *bm, int frame, PageNumber pageNum, bool firstPin) {
+    unsigned long version = frameState(bm, frame) & FRAME_VERSION_MASK;
+
+    if (firstPin || pthread_mutex_trylock(&(bm->strategyLatch)) != 0) {
+        if (!firstPin && pushHit(bm, frame, pageNum, version))
+            return;
+        pthread_mutex_lock(&(bm->strategyLatch));
+    }
+    // the hits left by others came first
+    applyHits(bm);
+    if (firstPin) {
+        if (bm->admission != NULL)
+            admissionRecord(bm->admission, pageNum);
+        if (strategyTracksHits(bm) && !frameInWindow(bm, frame))
+            prefetchHitAttribute(bm, bm->mgmtData + frame);
+    } else {
+        applyHit(bm, frame, pageNum, version);
+    }
+    pthread_mutex_unlock(&(bm->strategyLatch));
+}
+
+/***************************************************************
+ * Function Name: pushHit
+ *
+ * Description: append a hit to hitBuffer without any latch. A writer reserves a slot by moving hitTail, fills it and publishes it through the sequence number of the slot. Return FALSE if the buffer is full.
+ *
+ * Parameters: BM_BufferPool *bm, int frame, PageNumber pageNum, unsigned long version
+ *
+ * Return: bool
+ *
+***************************************************************/
+
+static bool pushHit(BM_BufferPool *bm, int frame, PageNumber pageNum, unsigned long version) {
+    BM_HitRecord *slot;
+    unsigned long pos, seq;
+
+    pos = __atomic_load_n(&(bm->hitTail), __ATOMIC_RELAXED);
+    while (1) {
+        slot = bm->hitBuffer + pos % HIT_BUFFER_SIZE;
+        seq = __atomic_load_n(&(slot->seq), __ATOMIC_ACQUIRE);
+        if (seq == pos) {
+            if (__atomic_compare_exchange_n(&(bm->hitTail), &pos, pos + 1, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if ((long)(seq - pos) < 0) {
+            return FALSE; // the slot still holds a hit nobody applied
+        } else {
+            pos = __atomic_load_n(&(bm->hitTail), __ATOMIC_RELAXED);
+        }
+    }
+    slot->frame = frame;
+    slot->pageNum = pageNum;
+    slot->version = version;
+    __atomic_store_n(&(slot->seq), pos + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+/***************************************************************
+ * Function Name: applyHits
+ *
+ * Description: apply the hits left in hitBuffer, oldest first, up to the first slot whose writer is not done. The caller holds the strategy latch. Called before every hit the latch holder applies itself and before the strategy orders its frames (takeFrame, flusherPass), so a victim is never chosen on stale hits.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void applyHits(BM_BufferPool *bm) {
+    BM_HitRecord *slot;
+
+    if (bm->hitBuffer == NULL)
+        return;
+    while (1) {
+        slot = bm->hitBuffer + bm->hitHead % HIT_BUFFER_SIZE;
+        if (__atomic_load_n(&(slot->seq), __ATOMIC_ACQUIRE) != bm->hitHead + 1)
+            return;
+        applyHit(bm, slot->frame, slot->pageNum, slot->version);
+        __atomic_store_n(&(slot->seq), bm->hitHead + HIT_BUFFER_SIZE, __ATOMIC_RELEASE);
+        bm->hitHead++;
+    }
+}
+
+/***************************************************************
+ * Function Name: applyHit
+ *
+ * Description: count a hit on pageNum for the admission filter and move its frame in the strategy. The strategy skips the hit if the frame no longer holds the page it had when it was pinned. The caller holds the strategy latch.
+ *
+ * Parameters: BM_BufferPool *bm, int frame, PageNumber pageNum, unsigned long version
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void applyHit(BM_BufferPool *bm, int frame, PageNumber pageNum, unsigned long version) {
+    if (bm->admission != NULL)
+        admissionRecord(bm->admission, pageNum);
+    if (strategyTracksHits(bm) && !frameInWindow(bm, frame)
+            && (frameState(bm, frame) & FRAME_VERSION_MASK) == version
+            && __atomic_load_n(&((bm->mgmtData + frame)->pageNum), __ATOMIC_ACQUIRE) == pageNum)
+        updataAttribute(bm, bm->mgmtData + frame);
+}
+
+/***************************************************************
+ * Function Name: pinFrameOptimistic
+ *
+ * Description: pin pageNum without any latch. The page table is read while others may change it, so the frame found is checked: its state word must show no I/O, and its page number is read between loading the word and swapping in the new pin count. Every eviction raises the version in the word, so a successful swap proves the page number belonged to the frame all along. Return -1 if that fails, the caller then takes the latched path.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PageTableShard *shard, PageNumber pageNum
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int pinFrameOptimistic(BM_BufferPool *bm, BM_PageTableShard *shard, PageNumber pageNum) {
+    unsigned long state;
+    int pnum;
+
+    pnum = pageTableLookup(&(shard->table), pageNum);
+    if (pnum < 0 || pnum >= bm->numPages)
+        return -1;
+    state = frameState(bm, pnum);
+    while (!(state & FRAME_BUSY) && (state & FRAME_PIN_MASK) != FRAME_PIN_MASK)
+    {
+        if (__atomic_load_n(&((bm->mgmtData + pnum)->pageNum), __ATOMIC_ACQUIRE) != pageNum)
+            return -1;
+        if (__atomic_compare_exchange_n(&(bm->frameSync[pnum].state), &state, (state + 1) | FRAME_REF,
+                                        TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return pnum;
+    }
+    return -1;
+}
+
+/***************************************************************
+ * Function Name: strategyTracksHits
+ *
+ * Description: whether the strategy has to see every hit under the strategy latch. FIFO ignores hits, CLOCK only needs the reference bit a pin sets and LRU only reorders when a page is released, so their hits take no latch.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: bool
+ *
+***************************************************************/
+
+static bool strategyTracksHits(BM_BufferPool *bm) {
+    return bm->strategy != RS_FIFO && bm->strategy != RS_LRU && bm->strategy != RS_CLOCK;
+}
+
+/***************************************************************
+ * Function Name: frameState
+ *
+ * Description: the state word of a frame, see FRAME_PIN_MASK.
+ *
+ * Parameters: BM_BufferPool *bm, int frame
+ *
+ * Return: unsigned long
+ *
+***************************************************************/
+
+static unsigned long frameState(BM_BufferPool *bm, int frame) {
+    return __atomic_load_n(&(bm->frameSync[frame].state), __ATOMIC_ACQUIRE);
+}
+
+/***************************************************************
+ * Function Name: framePins
+ *
+ * Description: number of pins of a frame.
+ *
+ * Parameters: BM_BufferPool *bm, int frame
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int framePins(BM_BufferPool *bm, int frame) {
+    return (int)(frameState(bm, frame) & FRAME_PIN_MASK);
+}
+
+/***************************************************************
+ * Function Name: takeFrame
+ *
+ * Description: find a frame for pageNum: a free frame, or the victim of the strategy (or an admission window frame) whose page is still unpinned. With cleanOnly a dirty victim is refused with RC_NO_FREE_FRAME. The caller holds the strategy latch and the latch of shard. The frame is returned pinned once, busy and with a new version. On return the shard latch of the victim page is held too; victimShard is NULL for an empty frame.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum, BM_PageTableShard *shard, bool cleanOnly, int *frame, BM_PageTableShard **victimShard, bool *victimDirty
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC takeFrame(BM_BufferPool *bm, PageNumber pageNum, BM_PageTableShard *shard, bool cleanOnly, int *frame, BM_PageTableShard **victimShard, bool *victimDirty) {
+    BM_PageTableShard *candidateShard;
+    PageNumber victimPage;
+    unsigned long state;
+    bool window;
+    int pnum;
+
+    *victimShard = NULL;
+    *victimDirty = FALSE;
+    applyHits(bm);
+    if (bm->numFreeFrames > 0) {
+        *frame = bm->freeFrames[--(bm->numFreeFrames)];
+        state = frameState(bm, *frame);
+        __atomic_store_n(&(bm->frameSync[*frame].state),
+                         ((state & FRAME_VERSION_MASK) + FRAME_VERSION_ONE) | FRAME_BUSY | FRAME_REF | 1, __ATOMIC_RELEASE);
+        return RC_OK;
+    }
+
+    while (1) {
+        pnum = chooseVictim(bm);
+        if (pnum == -2)
+            return RC_STRATEGY_NOT_FOUND;
+
+        // a page that is not hotter than the victim only gets a window frame
+        window = FALSE;
+        if (bm->admission != NULL && (pnum == -1
+                || admissionEstimate(bm->admission, pageNum) <= admissionEstimate(bm->admission, (bm->mgmtData + pnum)->pageNum)))
+        {
+            int candidate = admissionWindowVictim(bm);
+            if (candidate != -1) {
+                pnum = candidate;
+                window = TRUE;
+            }
+        }
+        if (pnum == -1)
+            return RC_NO_FREE_FRAME;
+
+        // claim the frame: the swap only succeeds on a word without pins, so it loses against a concurrent pin
+        victimPage = (bm->mgmtData + pnum)->pageNum;
+        candidateShard = NULL;
+        if (victimPage != NO_PAGE) {
+            candidateShard = pageShard(bm, victimPage);
+            if (candidateShard != shard)
+                pthread_mutex_lock(&(candidateShard->latch));
+        }
+        state = frameState(bm, pnum);
+        if (cleanOnly && (state & (FRAME_PIN_MASK | FRAME_BUSY | FRAME_DIRTY)) == FRAME_DIRTY) {
+            if (candidateShard != NULL && candidateShard != shard)
+                pthread_mutex_unlock(&(candidateShard->latch));
+            return RC_NO_FREE_FRAME;
+        }
+        if ((state & (FRAME_PIN_MASK | FRAME_BUSY)) != 0
+                || !__atomic_compare_exchange_n(&(bm->frameSync[pnum].state), &state,
+                                                ((state & FRAME_VERSION_MASK) + FRAME_VERSION_ONE) | FRAME_BUSY | FRAME_REF | 1,
+                                                FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            if (candidateShard != NULL && candidateShard != shard)
+                pthread_mutex_unlock(&(candidateShard->latch));
+            continue;
+        }
+        *victimDirty = (state & FRAME_DIRTY) != 0;
+
+        if (window)
+            admissionTakeWindowFrame(bm, pnum);
+        else if (state & FRAME_PREFETCHED)
+            forgetAttribute(bm, bm->mgmtData + pnum);
+        else
+            evictAttribute(bm, bm->mgmtData + pnum);
+        *frame = pnum;
+        *victimShard = candidateShard;
+        return RC_OK;
+    }
+}
+
+/***************************************************************
+ * Function Name: loadPage
+ *
+ * Description: bring pageNum into the pool and pin it. The frame is chosen and mapped under the latches (mapFrame), the write back of a dirty victim and the read run without them. The frame is marked busy meanwhile, so other pins of either page wait for this I/O. An empty page is not read: its frame is zeroed and marked dirty. frame is -1 if another thread loaded the page first.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum, bool empty, int *frame
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC loadPage(BM_BufferPool *bm, PageNumber pageNum, bool empty, int *frame) {
+    BM_PageTableShard *victimShard;
+    BM_PageHandle *handle;
+    PageNumber victimPage;
+    bool victimDirty;
+    int pnum;
+    RC RC_flag;
+
+    *frame = -1;
+    RC_flag = mapFrame(bm, pageNum, FALSE, &pnum, &victimPage, &victimDirty);
+    if (RC_flag != RC_OK || pnum == -1)
+        return RC_flag;
+    handle = bm->mgmtData + pnum;
+
+    if (victimDirty) {
+        // the flusher fell behind, let it start its next pass now
+        if (bm->filePool->flusher != NULL)
+            pthread_cond_signal(&(bm->filePool->flusher->wake));
+        RC_flag = writeFrame(bm, victimPage, handle->data);
+        if (RC_flag != RC_OK) {
+            restoreVictim(bm, pnum, pageNum, victimPage);
+            return RC_flag;
+        }
+        victimShard = pageShard(bm, victimPage);
+        pthread_mutex_lock(&(victimShard->latch));
+        pageTableRemove(&(victimShard->table), victimPage);
+        pthread_cond_broadcast(&(victimShard->ioDone));
+        pthread_mutex_unlock(&(victimShard->latch));
+    }
+
+    if (empty) {
+        // dirty before the frame stops being busy, so the flusher cannot see it clean
+        memset(handle->data, 0, PAGE_SIZE);
+        __atomic_fetch_or(&(bm->frameSync[pnum].state), FRAME_DIRTY, __ATOMIC_ACQ_REL);
+        RC_flag = finishLoad(bm, pnum, pageNum, RC_OK, FALSE);
+    } else if (bm->options.readOnly)
+        RC_flag = finishLoad(bm, pnum, pageNum, readMappedFrame(bm, pnum, pageNum), FALSE);
+    else
+        RC_flag = finishLoad(bm, pnum, pageNum, readFrame(bm, pageNum, handle->data), FALSE);
+    if (RC_flag != RC_OK)
+        return RC_flag;
+    *frame = pnum;
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: mapFrame
+ *
+ * Description: first step of loading pageNum, under the latches: take a frame for it (see takeFrame), unmap the old page unless it is dirty and map pageNum. The frame comes back pinned once and busy, the caller writes a dirty victim back, reads the page and ends with finishLoad. A prefetch only takes free or clean frames and does not count as a reference for the admission filter, the ARC and 2Q ghosts or the strategy (see prefetchAttribute). The ARC and 2Q bookkeeping of a miss is only committed once a frame was taken. frame is -1 if the page is already in the pool.
+ *
+ * Parameters: BM_BufferPool *bm, PageNumber pageNum, bool prefetch, int *frame, PageNumber *victimPage, bool *victimDirty
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC mapFrame(BM_BufferPool *bm, PageNumber pageNum, bool prefetch, int *frame, PageNumber *victimPage, bool *victimDirty) {
+    BM_PageTableShard *shard = pageShard(bm, pageNum);
+    BM_PageTableShard *victimShard;
+    BM_PageHandle *handle;
+    int pnum;
+    RC RC_flag;
+
+    *frame = -1;
+    *victimDirty = FALSE;
+    pthread_mutex_lock(&(bm->strategyLatch));
+    pthread_mutex_lock(&(shard->latch));
+    if (pageTableLookup(&(shard->table), pageNum) != -1) {
+        pthread_mutex_unlock(&(shard->latch));
+        pthread_mutex_unlock(&(bm->strategyLatch));
+        return RC_OK;
+    }
+    RC_flag = pageTableReserve(&(shard->table));
+    if (RC_flag != RC_OK) {
+        pthread_mutex_unlock(&(shard->latch));
+        pthread_mutex_unlock(&(bm->strategyLatch));
+        return RC_flag;
+    }
+
+    // a prefetch is no reference, it leaves the admission sketch and the ghosts alone
+    if (bm->admission != NULL && !prefetch)
+        admissionRecord(bm->admission, pageNum);
+    if (bm->strategy == RS_ARC && !prefetch)
+        arcNoteMiss(bm, pageNum);
+    if (bm->strategy == RS_2Q && !prefetch)
+        twoQNoteMiss(bm, pageNum);
+
+    RC_flag = takeFrame(bm, pageNum, shard, prefetch, &pnum, &victimShard, victimDirty);
+    if (RC_flag != RC_OK) {
+        if (bm->strategy == RS_ARC)
+            arcCancelMiss(bm);
+        if (bm->strategy == RS_2Q)
+            ((BM_2QData *)bm->strategyData)->missInA1out = FALSE;
+        pthread_mutex_unlock(&(shard->latch));
+        pthread_mutex_unlock(&(bm->strategyLatch));
+        return RC_flag;
+    }
+    handle = bm->mgmtData + pnum;
+    *victimPage = handle->pageNum;
+    if (victimShard != NULL) {
+        // a dirty victim stays mapped until it is written, so nobody reads its old version back
+        if (!*victimDirty)
+            pageTableRemove(&(victimShard->table), *victimPage);
+        if (victimShard != shard)
+            pthread_mutex_unlock(&(victimShard->latch));
+    }
+
+    __atomic_store_n(&(handle->pageNum), pageNum, __ATOMIC_RELEASE);
+    pageTableInsert(&(shard->table), pageNum, pnum);
+    if (bm->strategy == RS_ARC && !prefetch)
+        arcCommitMiss(bm, pageNum);
+    if (bm->strategy == RS_2Q && !prefetch)
+        twoQCommitMiss(bm, pageNum);
+    if (!frameInWindow(bm, pnum)) {
+        if (prefetch)
+            prefetchAttribute(bm, handle);
+        else
+            updataAttribute(bm, handle);
+    }
+    if (bm->strategy == RS_ARC)
+        arcCancelMiss(bm);
+    if (bm->strategy == RS_2Q)
+        ((BM_2QData *)bm->strategyData)->missInA1out = FALSE;
+    pthread_mutex_unlock(&(shard->latch));
+    pthread_mutex_unlock(&(bm->strategyLatch));
+    *frame = pnum;
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: finishLoad
+ *
+ * Description: last step of loading pageNum into a frame mapped by mapFrame, given the result of its read. On success the frame stops being busy and stays pinned; a prefetched page is flagged so its first pin counts as a prefetch hit. A failed frame stays busy until dropFrame, so no optimistic pin can take it. Waiting pins are woken either way.
+ *
+ * Parameters: BM_BufferPool *bm, int frame, PageNumber pageNum, RC read, bool prefetch
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC finishLoad(BM_BufferPool *bm, int frame, PageNumber pageNum, RC read, bool prefetch) {
+    BM_PageTableShard *shard = pageShard(bm, pageNum);
+
+    pthread_mutex_lock(&(shard->latch));
+    if (read != RC_OK) {
+        pageTableRemove(&(shard->table), pageNum);
+    } else {
+        if (prefetch)
+            __atomic_fetch_or(&(bm->frameSync[frame].state), FRAME_PREFETCHED, __ATOMIC_ACQ_REL);
+        __atomic_fetch_and(&(bm->frameSync[frame].state), ~FRAME_BUSY, __ATOMIC_ACQ_REL);
+    }
+    pthread_cond_broadcast(&(shard->ioDone));
+    pthread_mutex_unlock(&(shard->latch));
+
+    if (read != RC_OK)
+        dropFrame(bm, frame);
+    return read;
+}
+
+/***************************************************************
+ * Function Name: restoreVictim
+ *
+ * Description: undo loadPage when the dirty victim could not be written. The frame still holds the victim page, so it stays in the pool, dirty, and the strategy sees it as newly loaded.
+ *
+ * Parameters: BM_BufferPool *bm, int frame, PageNumber pageNum, PageNumber victimPage
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void restoreVictim(BM_BufferPool *bm, int frame, PageNumber pageNum, PageNumber victimPage) {
+    BM_PageTableShard *shard = pageShard(bm, pageNum);
+    BM_PageTableShard *victimShard = pageShard(bm, victimPage);
+    BM_PageHandle *handle = bm->mgmtData + frame;
+
+    pthread_mutex_lock(&(bm->strategyLatch));
+    pthread_mutex_lock(&(shard->latch));
+    if (victimShard != shard)
+        pthread_mutex_lock(&(victimShard->latch));
+
+    pageTableRemove(&(shard->table), pageNum);
+    if (!frameInWindow(bm, frame))
+        forgetAttribute(bm, handle);
+    __atomic_store_n(&(handle->pageNum), victimPage, __ATOMIC_RELEASE);
+    if (!frameInWindow(bm, frame)) {
+        updataAttribute(bm, handle);
+        releaseAttribute(bm, handle);
+    }
+    __atomic_store_n(&(bm->frameSync[frame].state),
+                     (frameState(bm, frame) & FRAME_VERSION_MASK) | FRAME_DIRTY, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&(shard->ioDone));
+    if (victimShard != shard) {
+        pthread_cond_broadcast(&(victimShard->ioDone));
+        pthread_mutex_unlock(&(victimShard->latch));
+    }
+    pthread_mutex_unlock(&(shard->latch));
+    pthread_mutex_unlock(&(bm->strategyLatch));
+}
+
+/***************************************************************
+ * Function Name: dropFrame
+ *
+ * Description: give a frame whose read failed back to the free frames. It is already unmapped and still pinned and busy from the failed load.
+ *
+ * Parameters: BM_BufferPool *bm, int frame
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void dropFrame(BM_BufferPool *bm, int frame) {
+    BM_PageHandle *handle = bm->mgmtData + frame;
+
+    pthread_mutex_lock(&(bm->strategyLatch));
+    if (frameInWindow(bm, frame)) {
+        listUnlinkFrame(&(bm->admission->window), frame);
+        bm->admission->freeWindow[(bm->admission->numFreeWindow)++] = frame;
+    } else {
+        forgetAttribute(bm, handle);
+        bm->freeFrames[(bm->numFreeFrames)++] = frame;
+    }
+    __atomic_store_n(&(handle->pageNum), NO_PAGE, __ATOMIC_RELEASE);
+    __atomic_store_n(&(bm->frameSync[frame].state), frameState(bm, frame) & FRAME_VERSION_MASK, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&(bm->strategyLatch));
+}
+
+/***************************************************************
+ * Function Name: flushFrame
+ *
+ * Description: write the page of a frame back if it is dirty and unpinned, see claimFlushFrame. A frame that is pinned, busy or clean is skipped.
+ *
+ * Parameters: BM_BufferPool *bm, int frame
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC flushFrame(BM_BufferPool *bm, int frame) {
+    PageNumber pageNum;
+    RC RC_flag;
+
+    if (!claimFlushFrame(bm, frame, &pageNum))
+        return RC_OK;
+    RC_flag = writeFrame(bm, pageNum, (bm->mgmtData + frame)->data);
+    releaseFlushFrame(bm, frame, RC_flag);
+    return RC_flag;
+}
+
+/***************************************************************
+ * Function Name: claimFlushFrame
+ *
+ * Description: pin a dirty, unpinned frame for a write back and clear its dirty flag, so a markDirty during the write is not lost. Return FALSE for a frame that is empty, pinned, busy or clean. A claimed frame is given back with releaseFlushFrame.
+ *
+ * Parameters: BM_BufferPool *bm, int frame, PageNumber *pageNum
+ *
+ * Return: bool
+ *
+***************************************************************/
+
+static bool claimFlushFrame(BM_BufferPool *bm, int frame, PageNumber *pageNum) {
+    BM_PageTableShard *shard;
+    unsigned long state;
+    bool claimed;
+
+    *pageNum = __atomic_load_n(&((bm->mgmtData + frame)->pageNum), __ATOMIC_ACQUIRE);
+    if (*pageNum == NO_PAGE)
+        return FALSE;
+
+    // the swap fails if a pin came first
+    shard = pageShard(bm, *pageNum);
+    pthread_mutex_lock(&(shard->latch));
+    state = frameState(bm, frame);
+    claimed = pageTableLookup(&(shard->table), *pageNum) == frame && (state & (FRAME_PIN_MASK | FRAME_BUSY)) == 0
+            && (state & FRAME_DIRTY)
+            && __atomic_compare_exchange_n(&(bm->frameSync[frame].state), &state, (state + 1) & ~FRAME_DIRTY,
+                                           FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    pthread_mutex_unlock(&(shard->latch));
+    return claimed;
+}
+
+/***************************************************************
+ * Function Name: releaseFlushFrame
+ *
+ * Description: unpin a frame claimed by claimFlushFrame. If its write failed the page is marked dirty again.
+ *
+ * Parameters: BM_BufferPool *bm, int frame, RC written
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void releaseFlushFrame(BM_BufferPool *bm, int frame, RC written) {
+    if (written != RC_OK)
+        __atomic_fetch_or(&(bm->frameSync[frame].state), FRAME_DIRTY, __ATOMIC_ACQ_REL);
+    __atomic_fetch_sub(&(bm->frameSync[frame].state), 1, __ATOMIC_ACQ_REL);
+}
+
+/***************************************************************
+ * Function Name: compareFlushEntries
+ *
+ * Description: qsort order of BM_FlushEntry, by page number.
+ *
+ * Parameters: const void *a, const void *b
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int compareFlushEntries(const void *a, const void *b) {
+    PageNumber x = ((const BM_FlushEntry *)a)->pageNum;
+    PageNumber y = ((const BM_FlushEntry *)b)->pageNum;
+
+    return (x > y) - (x < y);
+}
+
+/***************************************************************
+ * Function Name: startFlusher
+ *
+ * Description: start the background flusher of a pool whose frames are set up.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC startFlusher(BM_BufferPool *bm) {
+    BM_FlusherData *flusher;
+
+    flusher = (BM_FlusherData *)calloc(1, sizeof(BM_FlusherData));
+    if (flusher == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    flusher->order = (int *)malloc(bm->numPages * sizeof(int));
+    if (flusher->order == NULL) {
+        free(flusher);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    pthread_mutex_init(&(flusher->latch), NULL);
+    pthread_cond_init(&(flusher->wake), NULL);
+    pthread_cond_init(&(flusher->passDone), NULL);
+    flusher->stop = FALSE;
+    bm->flusher = flusher;
+    if (pthread_create(&(flusher->thread), NULL, flusherMain, bm) != 0) {
+        bm->flusher = NULL;
+        pthread_cond_destroy(&(flusher->passDone));
+        pthread_cond_destroy(&(flusher->wake));
+        pthread_mutex_destroy(&(flusher->latch));
+        free(flusher->order);
+        free(flusher);
+        return RC_THREAD_START_FAILED;
+    }
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: stopFlusher
+ *
+ * Description: stop the background flusher, if the pool runs one, and wait until its current pass is done.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void stopFlusher(BM_BufferPool *bm) {
+    BM_FlusherData *flusher = bm->flusher;
+
+    if (flusher == NULL)
+        return;
+    pthread_mutex_lock(&(flusher->latch));
+    flusher->stop = TRUE;
+    pthread_cond_signal(&(flusher->wake));
+    pthread_mutex_unlock(&(flusher->latch));
+    pthread_join(flusher->thread, NULL);
+
+    bm->flusher = NULL;
+    pthread_cond_destroy(&(flusher->passDone));
+    pthread_cond_destroy(&(flusher->wake));
+    pthread_mutex_destroy(&(flusher->latch));
+    free(flusher->order);
+    free(flusher);
+}
+
+/***************************************************************
+ * Function Name: wakeFlusher
+ *
+ * Description: wake the background flusher and wait until it has finished a whole pass that started after the call. A pass that is already running is waited out first, since it may have looked at a frame before the caller dirtied it.
+ *
+ * Parameters: BM_BufferPool *const bm
+ *
+ * Return: RC, RC_NO_FLUSHER if the pool was not started with options.backgroundFlush.
+ *
+***************************************************************/
+
+RC wakeFlusher(BM_BufferPool *const bm) {
+    BM_FlusherData *flusher = bm->filePool->flusher;
+    unsigned long target;
+
+    if (flusher == NULL)
+        return RC_NO_FLUSHER;
+
+    pthread_mutex_lock(&(flusher->latch));
+    target = flusher->passes + (flusher->running ? 2 : 1);
+    flusher->woken = TRUE;
+    pthread_cond_signal(&(flusher->wake));
+    while (flusher->passes < target && !flusher->stop)
+        pthread_cond_wait(&(flusher->passDone), &(flusher->latch));
+    pthread_mutex_unlock(&(flusher->latch));
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: flusherMain
+ *
+ * Description: body of the flusher thread: a pass over every partition, then sleep for options.flushIntervalMs, until a miss had to write its victim or until wakeFlusher asks for a pass.
+ *
+ * Parameters: void *arg, the BM_BufferPool
+ *
+ * Return: void *
+ *
+***************************************************************/
+
+static void *flusherMain(void *arg) {
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    BM_FlusherData *flusher = bm->flusher;
+    long intervalMs = bm->options.flushIntervalMs > 0 ? bm->options.flushIntervalMs : 10;
+    struct timespec deadline;
+    int i;
+
+    pthread_mutex_lock(&(flusher->latch));
+    while (!flusher->stop) {
+        flusher->woken = FALSE;
+        flusher->running = TRUE;
+        pthread_mutex_unlock(&(flusher->latch));
+        if (bm->partitions == NULL)
+            flusherPass(bm, flusher->order);
+        for (i = 0; i < bm->numPartitions; i++)
+            flusherPass(bm->partitions + i, flusher->order);
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += intervalMs / 1000;
+        deadline.tv_nsec += (intervalMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&(flusher->latch));
+        flusher->running = FALSE;
+        flusher->passes++;
+        pthread_cond_broadcast(&(flusher->passDone));
+        if (!flusher->stop && !flusher->woken)
+            pthread_cond_timedwait(&(flusher->wake), &(flusher->latch), &deadline);
+    }
+    pthread_cond_broadcast(&(flusher->passDone));
+    pthread_mutex_unlock(&(flusher->latch));
+    return NULL;
+}
+
+/***************************************************************
+ * Function Name: flusherPass
+ *
+ * Description: write dirty unpinned pages of one pool or partition, next victims first, until options.cleanPercent of its unpinned pages are clean. A failed write is left for the next pass or for the miss that evicts the page.
+ *
+ * Parameters: BM_BufferPool *bm, int *order
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void flusherPass(BM_BufferPool *bm, int *order) {
+    int cleanPercent = bm->options.cleanPercent > 0 ? bm->options.cleanPercent : 25;
+    int n, i, clean, need;
+
+    pthread_mutex_lock(&(bm->strategyLatch));
+    applyHits(bm);
+    n = evictionOrder(bm, order);
+    pthread_mutex_unlock(&(bm->strategyLatch));
+
+    clean = 0;
+    for (i = 0; i < n; i++) {
+        if (!(frameState(bm, order[i]) & FRAME_DIRTY))
+            clean++;
+    }
+    need = (n * cleanPercent + 99) / 100 - clean;
+    for (i = 0; i < n && need > 0; i++) {
+        if ((frameState(bm, order[i]) & (FRAME_DIRTY | FRAME_PIN_MASK | FRAME_BUSY)) != FRAME_DIRTY)
+            continue;
+        if (flushFrame(bm, order[i]) == RC_OK)
+            need--;
+    }
+}
+
+/***************************************************************
+ * Function Name: evictionOrder
+ *
+ * Description: list the unpinned frames holding a page, roughly in the order the strategy would evict them: admission window frames first, then the strategy lists from their victim end. RS_CLOCK starts at the hand, RS_LRU_K has no order and lists frames by index. The caller holds the strategy latch. Return the number of frames listed.
+ *
+ * Parameters: BM_BufferPool *bm, int *order
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int evictionOrder(BM_BufferPool *bm, int *order) {
+    int n = 0;
+    int i, frame, bucket;
+
+    if (bm->admission != NULL)
+        n = appendListOrder(bm, &(bm->admission->window), order, n);
+
+    switch (bm->strategy) {
+    case RS_FIFO:
+    case RS_LRU:
+        n = appendListOrder(bm, (BM_ListData *)bm->strategyData, order, n);
+        break;
+    case RS_ARC:
+        n = appendListOrder(bm, &(((BM_ARCData *)bm->strategyData)->t1), order, n);
+        n = appendListOrder(bm, &(((BM_ARCData *)bm->strategyData)->t2), order, n);
+        break;
+    case RS_2Q:
+        n = appendListOrder(bm, &(((BM_2QData *)bm->strategyData)->a1in), order, n);
+        n = appendListOrder(bm, &(((BM_2QData *)bm->strategyData)->am), order, n);
+        break;
+    case RS_LFU: {
+        BM_LFUData *lfu = (BM_LFUData *)bm->strategyData;
+
+        for (bucket = lfu->lowest; bucket != -1; bucket = lfu->bucketNext[bucket]) {
+            for (frame = lfu->bucketHead[bucket]; frame != -1; frame = lfu->next[frame]) {
+                if (framePins(bm, frame) == 0)
+                    order[n++] = frame;
+            }
+        }
+        break;
+    }
+    default: {
+        int start = (bm->strategy == RS_CLOCK) ? ((BM_ClockData *)bm->strategyData)->hand : 0;
+
+        for (i = 0; i < bm->numPages; i++) {
+            frame = (start + i) % bm->numPages;
+            if (bm->admission != NULL && frameInWindow(bm, frame))
+                continue;
+            if (framePins(bm, frame) == 0 && __atomic_load_n(&((bm->mgmtData + frame)->pageNum), __ATOMIC_ACQUIRE) != NO_PAGE)
+                order[n++] = frame;
+        }
+        break;
+    }
+    }
+    return n;
+}
+
+/***************************************************************
+ * Function Name: appendListOrder
+ *
+ * Description: append the unpinned frames of a strategy list to order, head first. Return the new length of order.
+ *
+ * Parameters: BM_BufferPool *bm, BM_ListData *list, int *order, int n
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int appendListOrder(BM_BufferPool *bm, BM_ListData *list, int *order, int n) {
+    int frame;
+
+    for (frame = list->head; frame != -1; frame = list->next[frame]) {
+        if (framePins(bm, frame) == 0)
+            order[n++] = frame;
+    }
+    return n;
+}
+
+/***************************************************************
+ * Function Name: comparePrefetchEntries
+ *
+ * Description: qsort order of BM_PrefetchEntry, by page number.
+ *
+ * Parameters: const void *a, const void *b
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int comparePrefetchEntries(const void *a, const void *b) {
+    PageNumber x = ((const BM_PrefetchEntry *)a)->pageNum;
+    PageNumber y = ((const BM_PrefetchEntry *)b)->pageNum;
+
+    return (x > y) - (x < y);
+}
+
+/***************************************************************
+ * Function Name: startPrefetcher
+ *
+ * Description: start the prefetcher thread of a pool. The caller holds the file latch.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC startPrefetcher(BM_BufferPool *bm) {
+    BM_PrefetcherData *prefetcher;
+
+    prefetcher = (BM_PrefetcherData *)calloc(1, sizeof(BM_PrefetcherData));
+    if (prefetcher == NULL)
+        return RC_MEMORY_ALLOCATION_FAIL;
+    prefetcher->queue = (BM_PrefetchEntry *)malloc(bm->numPages * sizeof(BM_PrefetchEntry));
+    prefetcher->batch = (BM_PrefetchEntry *)malloc(bm->numPages * sizeof(BM_PrefetchEntry));
+    prefetcher->data = (char **)malloc(bm->numPages * sizeof(char *));
+    prefetcher->pages = (PageNumber *)malloc(bm->numPages * sizeof(PageNumber));
+    prefetcher->results = (RC *)malloc(bm->numPages * sizeof(RC));
+    if (prefetcher->queue == NULL || prefetcher->batch == NULL || prefetcher->data == NULL
+            || prefetcher->pages == NULL || prefetcher->results == NULL) {
+        free(prefetcher->queue);
+        free(prefetcher->batch);
+        free(prefetcher->data);
+        free(prefetcher->pages);
+        free(prefetcher->results);
+        free(prefetcher);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    pthread_mutex_init(&(prefetcher->latch), NULL);
+    pthread_cond_init(&(prefetcher->wake), NULL);
+    prefetcher->stop = FALSE;
+    prefetcher->numQueued = 0;
+    if (pthread_create(&(prefetcher->thread), NULL, prefetcherMain, bm) != 0) {
+        pthread_cond_destroy(&(prefetcher->wake));
+        pthread_mutex_destroy(&(prefetcher->latch));
+        free(prefetcher->queue);
+        free(prefetcher->batch);
+        free(prefetcher->data);
+        free(prefetcher->pages);
+        free(prefetcher->results);
+        free(prefetcher);
+        return RC_THREAD_START_FAILED;
+    }
+    bm->prefetcher = prefetcher;
+    return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: stopPrefetcher
+ *
+ * Description: stop the prefetcher, if the pool runs one, after it has read every queued page.
+ *
+ * Parameters: BM_BufferPool *bm
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void stopPrefetcher(BM_BufferPool *bm) {
+    BM_PrefetcherData *prefetcher = bm->prefetcher;
+
+    if (prefetcher == NULL)
+        return;
+    pthread_mutex_lock(&(prefetcher->latch));
+    prefetcher->stop = TRUE;
+    pthread_cond_signal(&(prefetcher->wake));
+    pthread_mutex_unlock(&(prefetcher->latch));
+    pthread_join(prefetcher->thread, NULL);
+
+    bm->prefetcher = NULL;
+    pthread_cond_destroy(&(prefetcher->wake));
+    pthread_mutex_destroy(&(prefetcher->latch));
+    free(prefetcher->queue);
+    free(prefetcher->batch);
+    free(prefetcher->data);
+    free(prefetcher->pages);
+    free(prefetcher->results);
+    free(prefetcher);
+}
+
+/***************************************************************
+ * Function Name: prefetcherMain
+ *
+ * Description: body of the prefetcher thread: take every queued page, read them all with one readFrames call, then make the frames loaded and unpinned (see finishLoad). It leaves once it is stopped and the queue is empty.
+ *
+ * Parameters: void *arg, the BM_BufferPool
+ *
+ * Return: void *
+ *
+***************************************************************/
+
+static void *prefetcherMain(void *arg) {
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    BM_PrefetcherData *prefetcher;
+    BM_PrefetchEntry *batch;
+    int n, i;
+
+    // started under the file latch, bm->prefetcher is set once that latch is free
+    pthread_mutex_lock(&(bm->fileLatch));
+    prefetcher = bm->prefetcher;
+    pthread_mutex_unlock(&(bm->fileLatch));
+    batch = prefetcher->batch;
+
+    pthread_mutex_lock(&(prefetcher->latch));
+    while (1) {
+        while (prefetcher->numQueued == 0 && !prefetcher->stop)
+            pthread_cond_wait(&(prefetcher->wake), &(prefetcher->latch));
+        if (prefetcher->numQueued == 0)
+            break;
+        n = prefetcher->numQueued;
+        memcpy(batch, prefetcher->queue, n * sizeof(BM_PrefetchEntry));
+        prefetcher->numQueued = 0;
+        pthread_mutex_unlock(&(prefetcher->latch));
+
+        // several calls may have queued pages, sort them into one order and read them together
+        qsort(batch, n, sizeof(BM_PrefetchEntry), comparePrefetchEntries);
+        for (i = 0; i < n; i++) {
+            prefetcher->pages[i] = batch[i].pageNum;
+            prefetcher->data[i] = (batch[i].pool->mgmtData + batch[i].frame)->data;
+        }
+        readFrames(bm, prefetcher->pages, n, prefetcher->data, prefetcher->results, TRUE);
+        for (i = 0; i < n; i++) {
+            if (finishLoad(batch[i].pool, batch[i].frame, batch[i].pageNum, prefetcher->results[i], TRUE) == RC_OK)
+                unpinFrame(batch[i].pool, batch[i].frame);
+            __atomic_sub_fetch(&(batch[i].pool->numPrefetching), 1, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_lock(&(prefetcher->latch));
+    }
+    pthread_mutex_unlock(&(prefetcher->latch));
+    return NULL;
+}
+
+/***************************************************************
+ * Function Name: setPageHandle
+ *
+ * Description: fill a page handle for pageNum, pinned in frame.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PageHandle *page, int frame, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+
+static void setPageHandle(BM_BufferPool *bm, BM_PageHandle *page, int frame, PageNumber pageNum) {
+    unsigned long state = frameState(bm, frame);
+
+    page->data = (bm->mgmtData + frame)->data;
+    page->fixCounts = (int)(state & FRAME_PIN_MASK);
+    page->pageNum = pageNum;
+    page->dirty = (state & FRAME_DIRTY) != 0;
+    page->strategyAttribute = (bm->mgmtData + frame)->strategyAttribute;
+}
+
+/***************************************************************
+ * Function Name: comparePinEntries
+ *
+ * Description: qsort order of BM_PinEntry, by page number and then by position, so the first request of a page comes first.
+ *
+ * Parameters: const void *a, const void *b
+ *
+ * Return: int
+ *
+***************************************************************/
+
+static int comparePinEntries(const void *a, const void *b) {
+    const BM_PinEntry *x = (const BM_PinEntry *)a;
+    const BM_PinEntry *y = (const BM_PinEntry *)b;
+
+    if (x->pageNum != y->pageNum)
+        return (x->pageNum > y->pageNum) - (x->pageNum < y->pageNum);
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+/***************************************************************
+ * Function Name: writeMissVictims
+ *
+ * Description: write back the dirty victims of the frames pinPages mapped, sorted by page number, with one writeFrames call (one vectored write per run of consecutive pages, or one io_uring batch). A written victim is unmapped; the frame of a victim that failed gets its page back (see restoreVictim) and its miss is dropped.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PinEntry *entries, int numEntries
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC writeMissVictims(BM_BufferPool *bm, BM_PinEntry *entries, int numEntries) {
+    BM_FlushEntry *victims;
+    BM_PageTableShard *victimShard;
+    BM_PinEntry *entry;
+    PageNumber *pages;
+    char **data;
+    RC *results;
+    int n, i;
+    RC RC_flag = RC_OK;
+
+    victims = (BM_FlushEntry *)malloc(numEntries * sizeof(BM_FlushEntry));
+    pages = (PageNumber *)malloc(numEntries * sizeof(PageNumber));
+    data = (char **)malloc(numEntries * sizeof(char *));
+    results = (RC *)malloc(numEntries * sizeof(RC));
+    n = 0;
+    for (i = 0; i < numEntries; i++) {
+        if (!entries[i].miss || !entries[i].victimDirty)
+            continue;
+        if (victims == NULL || pages == NULL || data == NULL || results == NULL) {
+            restoreVictim(entries[i].pool, entries[i].frame, entries[i].pageNum, entries[i].victimPage);
+            entries[i].frame = -1;
+            entries[i].miss = FALSE;
+            RC_flag = RC_MEMORY_ALLOCATION_FAIL;
+            continue;
+        }
+        victims[n].pageNum = entries[i].victimPage;
+        victims[n].frame = i;
+        victims[n].pool = entries[i].pool;
+        n++;
+    }
+    if (n == 0) {
+        free(victims);
+        free(pages);
+        free(data);
+        free(results);
+        return RC_flag;
+    }
+    if (bm->flusher != NULL)
+        pthread_cond_signal(&(bm->flusher->wake));
+
+    qsort(victims, n, sizeof(BM_FlushEntry), compareFlushEntries);
+    for (i = 0; i < n; i++) {
+        entry = entries + victims[i].frame;
+        pages[i] = victims[i].pageNum;
+        data[i] = (entry->pool->mgmtData + entry->frame)->data;
+    }
+    writeFrames(bm, pages, n, data, results);
+
+    for (i = 0; i < n; i++) {
+        entry = entries + victims[i].frame;
+        if (results[i] != RC_OK) {
+            RC_flag = results[i];
+            restoreVictim(entry->pool, entry->frame, entry->pageNum, entry->victimPage);
+            entry->frame = -1;
+            entry->miss = FALSE;
+            continue;
+        }
+        victimShard = pageShard(entry->pool, entry->victimPage);
+        pthread_mutex_lock(&(victimShard->latch));
+        pageTableRemove(&(victimShard->table), entry->victimPage);
+        pthread_cond_broadcast(&(victimShard->ioDone));
+        pthread_mutex_unlock(&(victimShard->latch));
+    }
+    free(victims);
+    free(pages);
+    free(data);
+    free(results);
+    return RC_flag;
+}
+
+/***************************************************************
+ * Function Name: readMisses
+ *
+ * Description: read the pages of the frames pinPages mapped with one readFrames call (one vectored read per run of consecutive pages, or one io_uring batch) and end their loads (see finishLoad). The miss of a page that could not be read is dropped.
+ *
+ * Parameters: BM_BufferPool *bm, BM_PinEntry *entries, int numEntries
+ *
+ * Return: RC
+ *
+***************************************************************/
+
+static RC readMisses(BM_BufferPool *bm, BM_PinEntry *entries, int numEntries) {
+    BM_PinEntry **misses;
+    PageNumber *pages;
+    char **data;
+    RC *results;
+    int n, i;
+    RC RC_flag = RC_OK;
+
+    misses = (BM_PinEntry **)malloc(numEntries * sizeof(BM_PinEntry *));
+    pages = (PageNumber *)malloc(numEntries * sizeof(PageNumber));
+    data = (char **)malloc(numEntries * sizeof(char *));
+    results = (RC *)malloc(numEntries * sizeof(RC));
+    n = 0;
+    for (i = 0; i < numEntries; i++) {
+        if (!entries[i].miss)
+            continue;
+        if (misses == NULL || pages == NULL || data == NULL || results == NULL) {
+            finishLoad(entries[i].pool, entries[i].frame, entries[i].pageNum, RC_MEMORY_ALLOCATION_FAIL, FALSE);
+            entries[i].frame = -1;
+            RC_flag = RC_MEMORY_ALLOCATION_FAIL;
+            continue;
+        }
+        misses[n] = entries + i;
+        pages[n] = entries[i].pageNum;
+        data[n] = (entries[i].pool->mgmtData + entries[i].frame)->data;
+        n++;
+    }
+
+    // the entries are sorted by page number, so are the misses
+    if (n > 0)
+        readFrames(bm, pages, n, data, results, FALSE);
+    for (i = 0; i < n; i++) {
+        if (results[i] != RC_OK)
+            RC_flag = results[i];
+        if (finishLoad(misses[i]->pool, misses[i]->frame, misses[i]->pageNum, results[i], FALSE) != RC_OK)
+            misses[i]->frame = -1;
+        misses[i]->miss = FALSE;
+    }
+    free(misses);
+    free(pages);
+    free(data);
+    free(results);
+    return RC_flag;
+}
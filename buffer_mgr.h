@@ -7,17 +7,24 @@
 // Include bool DT
 #include "dt.h"
 
+// Include the page file handle the pool reads and writes through
+#include "storage_mgr.h"
+
+// Include the latches that let several threads share a pool
+#include <pthread.h>
+
 // Replacement Strategies
 typedef enum ReplacementStrategy {
   RS_FIFO = 0,
   RS_LRU = 1,
   RS_CLOCK = 2,
   RS_LFU = 3,
-  RS_LRU_K = 4
+  RS_LRU_K = 4,
+  RS_ARC = 5,
+  RS_2Q = 6
 } ReplacementStrategy;
 
-// Data Types and Structures
-typedef int PageNumber;
+// Data Types and Structures (PageNumber comes from storage_mgr.h)
 #define NO_PAGE -1
 
 typedef struct BM_PageHandle {
@@ -28,6 +35,254 @@ typedef struct BM_PageHandle {
   int *strategyAttribute; // record attribution for strategy, like midify time or create time.
 } BM_PageHandle;
 
+// Page table: open-addressing hash (linear probing) from PageNumber to frame index.
+typedef struct BM_PageTable {
+  int capacity; // number of slots, a power of two at least twice the number of entries.
+  int count; // number of entries.
+  struct BM_PageTable *retired; // slot arrays replaced by growth, kept until freePageTable for lock-free readers.
+  PageNumber *keys; // NO_PAGE marks an empty slot.
+  int *frames; // frame index stored for keys[i].
+} BM_PageTable;
+
+// Bookkeeping of RS_FIFO and RS_LRU: an intrusive doubly-linked list of frames, the head is the next victim.
+// FIFO links every loaded frame in load order, LRU links unpinned frames in the order they were released.
+typedef struct BM_ListData {
+  int *prev; // -1 at the head.
+  int *next; // -1 at the tail.
+  bool *linked; // whether the frame is in the list.
+  int head;
+  int tail;
+  int length;
+} BM_ListData;
+
+// Bookkeeping of RS_CLOCK: the clock hand. The reference bits are FRAME_REF in the frame state words.
+typedef struct BM_ClockData {
+  int hand; // next frame the hand looks at.
+} BM_ClockData;
+
+// Parameters of RS_LRU_K, passed as stratData of initBufferPool (NULL means k = 2, no correlation).
+typedef struct BM_LRUKParams {
+  int k; // number of references remembered per page.
+  int correlatedPeriod; // a pin within this many pins of the previous one is correlated and not counted.
+} BM_LRUKParams;
+
+// Bookkeeping of RS_LRU_K. Times are logical, the clock advances by one on every pin.
+typedef struct BM_LRUKData {
+  int k;
+  int correlatedPeriod;
+  long now;
+  long *history; // history[frame * k + i] is the (i+1)-th most recent uncorrelated reference, 0 if none.
+  long *last; // most recent reference of the frame, correlated or not, 0 if the frame holds no page.
+} BM_LRUKData;
+
+// Parameters of RS_LFU, passed as stratData of initBufferPool (NULL means no aging).
+typedef struct BM_LFUParams {
+  int agingPeriod; // halve every frequency after this many pins, 0 to never age.
+} BM_LFUParams;
+
+// Bookkeeping of RS_LFU. Frames with the same pin frequency share a bucket, buckets are
+// linked in increasing frequency so a pin moves a frame to the next bucket in O(1).
+typedef struct BM_LFUData {
+  int *count; // pin frequency of the page in each frame, 0 if it was never pinned.
+  int *bucketOf; // bucket of each frame, -1 if it is in none.
+  int *prev; // frames of one bucket, least recently counted first.
+  int *next;
+  int *bucketFreq; // frequency shared by the frames of a bucket.
+  int *bucketHead;
+  int *bucketTail;
+  int *bucketPrev; // buckets in increasing frequency.
+  int *bucketNext;
+  int *order; // scratch space used while aging.
+  int lowest; // bucket with the smallest frequency, -1 if there is none.
+  int freeBuckets; // unused buckets, linked through bucketNext.
+  int agingPeriod;
+  int pinsSinceAging;
+} BM_LFUData;
+
+// Page numbers remembered after their page left the pool, used by RS_ARC and RS_2Q.
+// Slots are linked into ghost lists (BM_ListData over slots) by the strategy.
+typedef struct BM_GhostData {
+  PageNumber *page; // page number remembered by each slot.
+  BM_PageTable table; // page number -> slot.
+  int *freeSlots; // stack of unused slots.
+  int numFreeSlots;
+} BM_GhostData;
+
+// Bookkeeping of RS_ARC (Megiddo and Modha). t1 and t2 list resident frames, b1 and b2 list
+// ghost slots that only remember the page numbers recently evicted from t1 and t2.
+typedef struct BM_ARCData {
+  BM_ListData t1; // frames whose page was referenced once since it was loaded, head is LRU.
+  BM_ListData t2; // frames whose page was referenced at least twice, head is LRU.
+  BM_ListData b1; // ghost slots of pages evicted from t1, head is LRU.
+  BM_ListData b2; // ghost slots of pages evicted from t2, head is LRU.
+  BM_GhostData ghosts; // slots of b1 and b2.
+  int target; // adaptive target size of t1.
+  bool missInB1; // the page being loaded was found in b1.
+  bool missInB2; // the page being loaded was found in b2.
+  bool dropFromT1; // t1 alone fills the directory, its victim is not remembered.
+  int missTarget; // target before the miss being loaded, restored if it finds no frame.
+  int trimGhosts; // 1 or 2: the oldest ghost of b1 or b2 goes once the miss has a frame.
+} BM_ARCData;
+
+// Parameters of RS_2Q, passed as stratData of initBufferPool (NULL means 25 and 50).
+typedef struct BM_2QParams {
+  int kinPercent; // share of the frames a1in may keep before its pages are evicted.
+  int koutPercent; // number of ghosts in a1out, as a share of the frames.
+} BM_2QParams;
+
+// Bookkeeping of RS_2Q (Johnson and Shasha). A page first enters a1in; only a page that is
+// pinned again after it went through a1out is admitted to am, so one scan cannot flush am.
+typedef struct BM_2QData {
+  BM_ListData a1in; // frames of pages seen once, FIFO, head is the oldest.
+  BM_ListData am; // frames of pages seen again after a1out, head is LRU.
+  BM_ListData a1out; // ghost slots of pages evicted from a1in, FIFO.
+  BM_GhostData ghosts; // slots of a1out.
+  int kin;
+  int kout;
+  bool missInA1out; // the page being loaded was found in a1out.
+} BM_2QData;
+
+// Optional features of a buffer pool, see initBufferPoolWithOptions. A zeroed struct gives
+// the same pool as initBufferPool.
+typedef struct BM_PoolOptions {
+  bool admissionFilter; // TinyLFU: evict a victim only for a page estimated to be hotter.
+  int admissionWindowPercent; // frames kept for pages the filter turns away, 1% if 0.
+  bool hugePages; // back the frame arena with huge pages when the system has them.
+  int partitions; // split the frames into this many independent sub-pools, one pool if 0 or 1.
+  bool backgroundFlush; // run a thread that writes dirty pages back before they are evicted.
+  int cleanPercent; // share of the unpinned frames the flusher keeps clean, 25% if 0.
+  int flushIntervalMs; // pause of the flusher between two passes, 10 ms if 0.
+  int readAheadPages; // pages read ahead once pins run sequentially, 0 for no read-ahead.
+  SM_IOBackend ioBackend; // SM_IO_URING keeps the reads and writes of page runs in flight together, with the frames registered.
+  bool directIO; // open the page file with O_DIRECT, pages are cached in the frames only.
+  bool readOnly; // map the page file and pin pages in place in the mapping, frames hold no copy and markDirty fails.
+  SM_AccessPattern accessPattern; // madvise hint for the mapping of a read-only pool.
+  SM_GrowthMode fileGrowth; // SM_GROW_PREALLOCATE reserves blocks a whole extent ahead when pins grow the file.
+  int growthExtentPages; // preallocation step of SM_GROW_PREALLOCATE, SM_EXTENT_PAGES if 0.
+} BM_PoolOptions;
+
+// TinyLFU admission filter. A count-min sketch estimates how often each page was pinned
+// recently; every counter is halved after sampleSize pins so the estimate follows the load.
+// Pages that lose against the victim of the strategy are loaded into window frames, which
+// the strategy never sees and which are reused in FIFO order.
+typedef struct BM_AdmissionData {
+  unsigned char *sketch; // ADMISSION_SKETCH_DEPTH rows of width counters, saturating at 15.
+  int width; // counters per row, a power of two.
+  int additions; // pins counted since the last halving.
+  int sampleSize;
+  bool *inWindow; // frames reserved for pages that were not admitted.
+  BM_ListData window; // occupied window frames, oldest first.
+  int *freeWindow; // stack of empty window frames.
+  int numFreeWindow;
+} BM_AdmissionData;
+
+#define ADMISSION_SKETCH_DEPTH 4
+
+// A dirty frame collected by forceFlushPool, which writes them sorted by page number.
+typedef struct BM_FlushEntry {
+  PageNumber pageNum;
+  int frame;
+  struct BM_BufferPool *pool; // partition of the frame.
+} BM_FlushEntry;
+
+// Background flusher of a pool. Every pass looks at the unpinned frames of each partition in
+// the order the strategy would evict them and writes dirty ones until cleanPercent of them
+// are clean, so most misses find a clean victim and do not wait for a write.
+typedef struct BM_FlusherData {
+  pthread_t thread;
+  pthread_mutex_t latch; // protects stop, woken, running and passes.
+  pthread_cond_t wake; // signalled on shutdown, by wakeFlusher and when a miss had to write its victim.
+  pthread_cond_t passDone; // broadcast after every pass and when the thread exits.
+  bool stop;
+  bool woken; // wakeFlusher asked for a pass, do not sleep before it.
+  bool running; // a pass is in progress.
+  unsigned long passes; // passes done so far.
+  int *order; // scratch space of a pass, frames in eviction order.
+} BM_FlusherData;
+
+// A page of pinPages: the handle it fills and, for a miss, the frame and victim mapFrame chose.
+typedef struct BM_PinEntry {
+  struct BM_BufferPool *pool; // pool or partition of the page.
+  PageNumber pageNum;
+  int index; // position in pageNums and handles.
+  int frame; // -1 until the page is pinned.
+  bool miss; // the frame was mapped by pinPages and still has to be read.
+  PageNumber victimPage;
+  bool victimDirty;
+} BM_PinEntry;
+
+// A page mapped by prefetchPages and waiting for the prefetcher to read it.
+typedef struct BM_PrefetchEntry {
+  struct BM_BufferPool *pool; // pool or partition holding frame.
+  PageNumber pageNum;
+  int frame;
+} BM_PrefetchEntry;
+
+// Background reader of prefetchPages. The caller maps the pages to frames and queues them, the
+// thread reads every run of consecutive pages with one vectored read. Each queued page holds a
+// frame, so the queue never holds more entries than the pool has frames.
+typedef struct BM_PrefetcherData {
+  pthread_t thread;
+  pthread_mutex_t latch; // protects queue, numQueued and stop.
+  pthread_cond_t wake; // signalled when pages are queued and on shutdown.
+  bool stop;
+  BM_PrefetchEntry *queue;
+  int numQueued;
+  BM_PrefetchEntry *batch; // scratch space of the thread, the entries it is reading.
+  char **data; // scratch space of the thread, frames of the batch.
+  PageNumber *pages; // scratch space of the thread, pages of the batch.
+  RC *results; // scratch space of the thread, outcome of each read.
+} BM_PrefetcherData;
+
+#define FRAME_ARENA_HUGE_PAGE (2L * 1024 * 1024)
+
+// One partition of the page table. Pages are spread over the shards by hash, so threads
+// pinning different pages rarely wait on the same latch.
+typedef struct BM_PageTableShard {
+  pthread_mutex_t latch; // serialises changes of table, lookups of hits need no latch.
+  pthread_cond_t ioDone; // broadcast when a frame mapped here finishes its I/O.
+  BM_PageTable table;
+} BM_PageTableShard;
+
+#define PAGE_TABLE_MAX_SHARDS 16
+
+// Layout of BM_FrameSync.state. Everything a pin has to check is in one word, so pinning
+// and unpinning is a single compare-and-swap and eviction only succeeds on a word without pins.
+#define FRAME_PIN_MASK 0xFFFFUL // number of pins.
+#define FRAME_DIRTY (1UL << 16)
+#define FRAME_REF (1UL << 17) // reference bit of RS_CLOCK, set by every pin.
+#define FRAME_BUSY (1UL << 18) // the frame is being written back or read, pins of its pages wait for it.
+#define FRAME_PREFETCHED (1UL << 19) // the page was read ahead and has not been pinned since.
+#define FRAME_VERSION_ONE (1UL << 20) // the version above counts the pages the frame has held.
+#define FRAME_VERSION_MASK (~(FRAME_VERSION_ONE - 1))
+
+// Concurrency state of a frame.
+typedef struct BM_FrameSync {
+  pthread_rwlock_t latch; // content latch of the page, taken by latchPage.
+  unsigned long state; // pins, flags and version, see FRAME_PIN_MASK.
+} BM_FrameSync;
+
+// A sequential scan followed by read-ahead. Several scans of one pool are told apart by the page
+// each one pins next.
+typedef struct BM_ReadAheadStream {
+  PageNumber next; // page whose pin continues the scan.
+  PageNumber end; // last page read ahead for the scan, NO_PAGE before its first read-ahead.
+} BM_ReadAheadStream;
+
+#define READ_AHEAD_STREAMS 4
+
+// A hit whose strategy bookkeeping waits for the strategy latch. A pin that finds the latch taken
+// leaves the hit here and the next holder of the latch applies it, unless the frame has held
+// another page since (version).
+typedef struct BM_HitRecord {
+  unsigned long seq; // position + 1 once the record is written, position + HIT_BUFFER_SIZE once it is applied.
+  int frame;
+  PageNumber pageNum;
+  unsigned long version; // FRAME_VERSION_MASK bits of the frame when it was pinned.
+} BM_HitRecord;
+
+#define HIT_BUFFER_SIZE 64
+
 typedef struct BM_BufferPool {
   char *pageFile;
   int numPages;
@@ -36,7 +291,32 @@ typedef struct BM_BufferPool {
                   // manager needs for a buffer pool
   int numReadIO; // the number of read from page file.                
   int numWriteIO; // the number of write from page file.                               
-  int timer; // initial is 0, use this timer to compare modify/create time.
+  SM_FileHandle fileHandle; // page file kept open for the lifetime of the pool.
+  BM_PageTableShard *pageTable; // find the frame holding a page without scanning mgmtData.
+  int numShards; // a power of two.
+  BM_FrameSync *frameSync;
+  pthread_mutex_t strategyLatch; // protects strategyData, freeFrames and admission, taken before any shard latch.
+  pthread_mutex_t fileLatch; // protects the size of fileHandle.
+  int *freeFrames; // stack of empty frames, top is the lowest index.
+  int numFreeFrames;
+  char *frameArena; // page aligned memory of all frames, frame i starts at i * PAGE_SIZE.
+  long frameArenaSize; // bytes mapped for frameArena.
+  BM_PoolOptions options;
+  BM_AdmissionData *admission; // NULL unless options.admissionFilter is set.
+  void *strategyData; // pool wide bookkeeping of the strategy, e.g. BM_ListData for RS_FIFO and RS_LRU, BM_ClockData for RS_CLOCK, BM_LRUKData for RS_LRU_K, BM_LFUData for RS_LFU, BM_ARCData for RS_ARC, BM_2QData for RS_2Q.
+  struct BM_BufferPool *partitions; // sub-pools a page is routed to by hash, NULL for a single pool.
+  int numPartitions;
+  struct BM_BufferPool *filePool; // pool that owns fileHandle and counts the I/O, the pool itself unless it is a partition.
+  BM_FlusherData *flusher; // NULL unless options.backgroundFlush is set, only the pool that owns the file has one.
+  int numPrefetchIO; // pages read ahead, not counted in numReadIO.
+  int numPrefetchHits; // pins that found a page read ahead for them.
+  BM_ReadAheadStream streams[READ_AHEAD_STREAMS]; // scans followed by read-ahead.
+  unsigned int nextStream; // round robin over streams when a new scan needs one.
+  BM_PrefetcherData *prefetcher; // started by the first prefetchPages, only the pool that owns the file has one.
+  int numPrefetching; // frames mapped by prefetchPages whose read is not done yet.
+  BM_HitRecord *hitBuffer; // ring of HIT_BUFFER_SIZE hits waiting for the strategy latch.
+  unsigned long hitHead; // next record to apply, only changed under strategyLatch.
+  unsigned long hitTail; // next record to write.
 } BM_BufferPool;
 
 
@@ -51,8 +331,12 @@ typedef struct BM_BufferPool {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		  const int numPages, ReplacementStrategy strategy, 
 		  void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+		  const int numPages, ReplacementStrategy strategy,
+		  void *stratData, const BM_PoolOptions *options);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC wakeFlusher(BM_BufferPool *const bm);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -60,6 +344,12 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 	    const PageNumber pageNum);
+RC latchPage (BM_BufferPool *const bm, BM_PageHandle *const page, bool exclusive);
+RC unlatchPage (BM_BufferPool *const bm, BM_PageHandle *const page);
+RC pinPages (BM_BufferPool *const bm, BM_PageHandle *const handles,
+	    const PageNumber *pageNums, int numPages);
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pageNums, int numPages);
+RC pinNewPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -67,12 +357,39 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumPrefetchIO (BM_BufferPool *const bm);
+int getNumPrefetchHits (BM_BufferPool *const bm);
 
 // Added by myself
 int strategyFIFOandLRU(BM_BufferPool *bm);
 //int strategyLRU(BM_BufferPool *bm);
 int strategyLRU_k(BM_BufferPool *bm);
-int *getAttributionArray(BM_BufferPool *bm);
+int strategyClock(BM_BufferPool *bm);
+int strategyLFU(BM_BufferPool *bm);
+int strategyARC(BM_BufferPool *bm);
+void arcNoteMiss(BM_BufferPool *bm, PageNumber pageNum);
+void arcCommitMiss(BM_BufferPool *bm, PageNumber pageNum);
+void arcCancelMiss(BM_BufferPool *bm);
+int strategy2Q(BM_BufferPool *bm);
+void twoQNoteMiss(BM_BufferPool *bm, PageNumber pageNum);
+void twoQCommitMiss(BM_BufferPool *bm, PageNumber pageNum);
+RC initStrategyData(BM_BufferPool *bm, void *stratData);
+void freeStrategyData(BM_BufferPool *bm);
 void freePagesBuffer(BM_BufferPool *bm);
 RC updataAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle);
+RC releaseAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle);
+RC evictAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle);
+RC forgetAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle);
+RC prefetchAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle);
+RC prefetchHitAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle);
+RC initAdmission(BM_BufferPool *bm);
+void freeAdmission(BM_BufferPool *bm);
+void admissionRecord(BM_AdmissionData *admission, PageNumber pageNum);
+int admissionEstimate(BM_AdmissionData *admission, PageNumber pageNum);
+RC initPageTable(BM_PageTable *table, int numPages);
+void freePageTable(BM_PageTable *table);
+int pageTableLookup(BM_PageTable *table, PageNumber pageNum);
+RC pageTableReserve(BM_PageTable *table);
+void pageTableInsert(BM_PageTable *table, PageNumber pageNum, int frame);
+void pageTableRemove(BM_PageTable *table, PageNumber pageNum);
 #endif
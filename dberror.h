@@ -18,6 +18,20 @@ typedef int RC;
 #define RC_GET_NUMBER_OF_BYTES_FAILED 6 //added by myself in assign 1
 #define RC_SHUTDOWN_POOL_FAILED 7 //added by myself in assign 2
 #define RC_STRATEGY_NOT_FOUND 8 //added by myself in assign 2
+#define RC_NO_FREE_FRAME 9 //every frame in the pool is pinned
+#define RC_MEMORY_ALLOCATION_FAIL 10
+#define RC_PAGE_NOT_PINNED 11 //the page is not in the pool
+#define RC_THREAD_START_FAILED 12 //the background flusher could not be started
+#define RC_IO_BACKEND_NOT_AVAILABLE 13 //the kernel does not offer the asked I/O backend
+#define RC_DIRECT_IO_NOT_AVAILABLE 14 //the file system does not support O_DIRECT
+#define RC_POOL_READ_ONLY 15 //markDirty on a pool that serves pages from a read-only mapping
+#define RC_MAP_FAILED 16 //the page file could not be mapped into memory
+#define RC_PREALLOCATE_NOT_AVAILABLE 17 //the file system cannot preallocate blocks with fallocate
+#define RC_NO_FREE_MAP 18 //the page file was not created with a free-space map
+#define RC_PAGE_NOT_ALLOCATED 19 //freePage on a free page or a page of the free-space map
+#define RC_FREE_MAP_FULL 20 //the page lies past the pages the free-space map can track
+#define RC_HEADER_PAGE 21 //the page holds the free-space map and cannot be read, written or pinned
+#define RC_NO_FLUSHER 22 //wakeFlusher on a pool that runs no background flusher
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
@@ -1,21 +1,78 @@
+#define _GNU_SOURCE		//O_DIRECT, fallocate
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <errno.h>
 #include <string.h>
 #include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <pthread.h>
 #include "storage_mgr.h"
 
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024		//the Linux limit, limits.h only defines it for _XOPEN_SOURCE.
+#endif
+
+//io_uring is used through its system calls, IORING_FEAT_RW_CUR_POS came with the plain read and write opcodes.
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define SM_HAVE_IO_URING 1
+
+/* an io_uring and its mapped queues, owned by SM_FileMgmtInfo.ring */
+struct SM_IORing {
+	int fd;
+	pthread_mutex_t latch;		//one batch at a time owns the ring, other callers take the synchronous path.
+	unsigned numEntries;
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sqRing, *cqRing;
+	size_t sqRingSize, cqRingSize, sqesSize;
+	struct iovec *buffers;		//registered buffers, fixed reads and writes into them are not mapped per request.
+	int numBuffers;
+};
+#endif
+
+//page 0 of a file with a free-space map starts with the magic and the number of map pages, the bitmap follows.
+#define SM_FREE_MAP_MAGIC "SMFREEMP"
+#define SM_FREE_MAP_HEADER 16
+
+static char zeroPage[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));		//aligned for O_DIRECT writes.
+
+static int getFileDescriptor (SM_FileHandle *fHandle);
+static int isDirectIO (SM_FileHandle *fHandle);
+static int pagesAligned (SM_PageHandle *memPages, int numPages);
+static int isHeaderPage (SM_FileHandle *fHandle, PageNumber pageNum);
+static RC readPageAt (SM_FileHandle *fHandle, PageNumber pageNum, SM_PageHandle memPage);
+static RC writePageAt (SM_FileHandle *fHandle, PageNumber pageNum, const char *memPage);
+static void adviseReadAhead (SM_FileHandle *fHandle, PageNumber pageNum);
+static int preallocatePages (int fd, PageNumber pageNum, PageNumber numPages);
+static int punchPage (int fd, PageNumber pageNum);
+static RC loadFreeMap (SM_FileHandle *fHandle);
+static PageNumber freeMapCapacity (SM_FileMgmtInfo *info);
+static RC writeFreeMapBit (SM_FileHandle *fHandle, PageNumber pageNum, int isFree);
+static RC openRing (SM_FileMgmtInfo *info);
+static void closeRing (SM_FileMgmtInfo *info);
+static int ringTransfer (SM_FileHandle *fHandle, PageNumber pageNum, const PageNumber *pageNums, int numPages, SM_PageHandle *memPages, int write, RC *results, RC *result);
+
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
 /*
 typedef struct SM_FileHandle {
   char *fileName;
-  int totalNumPages;
-  int curPagePos;
+  PageNumber totalNumPages;
+  PageNumber curPagePos;
   void *mgmtInfo;
 } SM_FileHandle;
 
@@ -36,8 +93,8 @@ extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
 /*
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
-extern int getBlockPos (SM_FileHandle *fHandle);
+extern RC readBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern PageNumber getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
@@ -47,10 +104,10 @@ extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 
 /* writing blocks to a page file */
 /*
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
-extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC ensureCapacity (PageNumber numberOfPages, SM_FileHandle *fHandle);
 */
 
 /* manipulating page files */
@@ -111,7 +168,6 @@ RC createPageFile(char *fileName) {
 	fp = fopen(fileName, "w");
 
 	if (fp == NULL) {
-		fclose(fp);
 		return RC_CREATE_FILE_FAIL;
 	}
 
@@ -147,33 +203,55 @@ RC createPageFile(char *fileName) {
 
 
 RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
-	FILE *fp;
-	int size;
-	int seek_result;
-
-	fp = fopen(fileName, "r");
+	SM_FileMgmtInfo *info;
+	struct stat st;
+	int fd;
+	RC rv;
 
-	if (fp == NULL) {
+	fd = open(fileName, O_RDWR);
+	if (fd == -1 && (errno == EACCES || errno == EROFS)) {
+		fd = open(fileName, O_RDONLY);		//read-only files can still be read through the handle.
+	}
+	if (fd == -1) {
 		return RC_FILE_NOT_FOUND;
 	}
 
-	seek_result = fseek(fp, 0, SEEK_END);
-
-	if (seek_result != 0) {
-		fclose(fp);
+	if (fstat(fd, &st) != 0) {
+		close(fd);
 		return RC_GET_NUMBER_OF_BYTES_FAILED;
 	}
 
-	size = ftell(fp);
-	if (size == -1) {
-		fclose(fp);
-		return RC_GET_NUMBER_OF_BYTES_FAILED;
+	info = (SM_FileMgmtInfo *)malloc(sizeof(SM_FileMgmtInfo));
+	if (info == NULL) {
+		close(fd);
+		return RC_MEMORY_ALLOCATION_FAIL;
 	}
+	info->fd = fd;
+	info->readAheadEnd = 0;
+	info->ring = NULL;
+	info->ringPages = 0;
+	info->direct = 0;
+	info->map = NULL;
+	info->mapSize = 0;
+	info->mapPages = 0;
+	info->growth = SM_GROW_SPARSE;
+	info->extentPages = SM_EXTENT_PAGES;
+	info->allocatedEnd = (PageNumber)((st.st_size + PAGE_SIZE - 1) / PAGE_SIZE);
+	info->freeMap = NULL;
+	info->freeMapPages = 0;
+	info->numFreePages = 0;
+	info->freeHint = 0;
 
 	fHandle->fileName = fileName;
-	fHandle->totalNumPages = (int)(size % PAGE_SIZE + 1);
+	fHandle->totalNumPages = (PageNumber)((st.st_size + PAGE_SIZE - 1) / PAGE_SIZE);
 	fHandle->curPagePos = 0;
+	fHandle->mgmtInfo = info;
 
+	rv = loadFreeMap(fHandle);
+	if (rv != RC_OK) {
+		closePageFile(fHandle);
+		return rv;
+	}
 	return RC_OK;
 
 }
@@ -197,6 +275,16 @@ RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
 
 
 RC closePageFile (SM_FileHandle *fHandle) {
+	SM_FileMgmtInfo *info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+
+	if (info != NULL) {
+		unmapPageFile(fHandle);
+		closeRing(info);
+		close(info->fd);
+		free(info->freeMap);
+		free(info);
+	}
+	fHandle->mgmtInfo = NULL;
 	fHandle->fileName = "";
 	fHandle->curPagePos = 0;
 	fHandle->totalNumPages = 0;
@@ -231,6 +319,50 @@ RC destroyPageFile (char *fileName) {
 	}
 }
 
+/***************************************************************
+ * Function Name: createPageFileWithFreeMap
+ *
+ * Description: create a new page file that keeps track of its free pages. Its first pages hold a bitmap with one bit for each of the first maxPages pages, set while the page is free. The bitmap is read by openPageFile and kept up to date by allocatePage and freePage; the pages that hold it are never handed out. The file starts with only these header pages.
+ *
+ * Parameters: char *fileName, PageNumber maxPages
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC createPageFileWithFreeMap (char *fileName, PageNumber maxPages) {
+	FILE *fp;
+	char *fill;
+	size_t size;
+	int32_t mapPages;
+
+	if (maxPages < 1) {
+		return RC_CREATE_FILE_FAIL;
+	}
+	mapPages = (int32_t)((SM_FREE_MAP_HEADER + (maxPages + 7) / 8 + PAGE_SIZE - 1) / PAGE_SIZE);
+	size = (size_t)mapPages * PAGE_SIZE;
+	fill = (char *)calloc(1, size);
+	if (fill == NULL) {
+		return RC_CREATE_FILE_FAIL;
+	}
+	memcpy(fill, SM_FREE_MAP_MAGIC, 8);
+	memcpy(fill + 8, &mapPages, sizeof(int32_t));
+
+	fp = fopen(fileName, "w");
+	if (fp == NULL) {
+		free(fill);
+		return RC_CREATE_FILE_FAIL;
+	}
+	if (fwrite(fill, 1, size, fp) != size) {
+		fclose(fp);
+		free(fill);
+		destroyPageFile(fileName);
+		return RC_CREATE_FILE_FAIL;
+	}
+	fclose(fp);
+	free(fill);
+	return RC_OK;
+}
+
 /* reading blocks from disc */
 
 
@@ -239,7 +371,7 @@ RC destroyPageFile (char *fileName) {
  *
  * Description: read the pageNum block from the file defined by fHandle into address memPage
  *
- * Parameters:int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage
+ * Parameters:PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage
  *
  * Return:RC
  *
@@ -252,22 +384,19 @@ RC destroyPageFile (char *fileName) {
 ***************************************************************/
 
 
-RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+RC readBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
+	RC rv;
+
 	if (pageNum > fHandle->totalNumPages - 1 || pageNum < 0)
 		return RC_READ_NON_EXISTING_PAGE;
-	else
-	{
-		FILE *fp;
-		fp = fopen(fHandle->fileName, "r");
-		int offset;
-		offset = fHandle->curPagePos * PAGE_SIZE;
-		fseek(fp, offset, SEEK_SET);
-		fread(memPage, sizeof(char), PAGE_SIZE, fp);
+	if (isHeaderPage(fHandle, pageNum))
+		return RC_HEADER_PAGE;
+
+	rv = readPageAt(fHandle, pageNum, memPage);
+	if (rv == RC_OK)
 		fHandle->curPagePos = pageNum;
-		fclose(fp);
-		return RC_OK;
-	}
+	return rv;
 }
 
 /***************************************************************
@@ -288,7 +417,7 @@ RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 ***************************************************************/
 
 
-int getBlockPos (SM_FileHandle *fHandle)
+PageNumber getBlockPos (SM_FileHandle *fHandle)
 {
 	return fHandle->curPagePos;
 }
@@ -313,13 +442,7 @@ int getBlockPos (SM_FileHandle *fHandle)
 
 RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
-	FILE *fp;
-	fp = fopen(fHandle->fileName, "r");
-	fseek(fp, 0, SEEK_SET);
-	fread(memPage, sizeof(char), PAGE_SIZE, fp);
-	fHandle->curPagePos = 0;
-	fclose(fp);
-	return RC_OK;
+	return readBlock(0, fHandle, memPage);
 }
 
 /***************************************************************
@@ -345,16 +468,7 @@ RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 	if (fHandle->curPagePos <= 0 || fHandle->curPagePos > fHandle->totalNumPages - 1)
 		return RC_READ_NON_EXISTING_PAGE;
 	else
-	{
-		FILE *fp;
-		fp = fopen(fHandle->fileName, "r");
-		int offset = (fHandle->curPagePos - 1) * PAGE_SIZE;
-		fseek(fp, offset, SEEK_SET);
-		fread(memPage, sizeof(char), PAGE_SIZE, fp);
-		fHandle->curPagePos = fHandle->curPagePos - 1;
-		fclose(fp);
-		return RC_OK;
-	}
+		return readBlock(fHandle->curPagePos - 1, fHandle, memPage);
 }
 
 /***************************************************************
@@ -379,16 +493,10 @@ RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
 	if (fHandle->curPagePos < 0 || fHandle->curPagePos > fHandle->totalNumPages - 1)
 		return RC_READ_NON_EXISTING_PAGE;
+	else if (isHeaderPage(fHandle, fHandle->curPagePos))
+		return RC_HEADER_PAGE;
 	else
-	{
-		FILE *fp;
-		fp = fopen(fHandle->fileName, "r");
-		int offset = fHandle->curPagePos * PAGE_SIZE;
-		fseek(fp, offset, SEEK_SET);
-		fread(memPage, sizeof(char), PAGE_SIZE, fp);
-		fclose(fp);
-		return RC_OK;
-	}
+		return readPageAt(fHandle, fHandle->curPagePos, memPage);
 }
 
 /***************************************************************
@@ -413,17 +521,9 @@ RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
 	if (fHandle->curPagePos < 0 || fHandle->curPagePos > fHandle->totalNumPages - 2)
 		return RC_READ_NON_EXISTING_PAGE;
-	else
-	{
-		FILE *fp;
-		fp = fopen(fHandle->fileName, "r");
-		int offset = (fHandle->curPagePos + 1) * PAGE_SIZE;
-		fseek(fp, offset, SEEK_SET);
-		fread(memPage, sizeof(char), PAGE_SIZE, fp);
-		fHandle->curPagePos = fHandle->curPagePos + 1;
-		fclose(fp);
-		return RC_OK;
-	}
+
+	adviseReadAhead(fHandle, fHandle->curPagePos + 1);
+	return readBlock(fHandle->curPagePos + 1, fHandle, memPage);
 }
 
 /***************************************************************
@@ -446,13 +546,87 @@ RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 
 RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
-	FILE *fp;
-	fp = fopen(fHandle->fileName, "r");
-	int offset = -PAGE_SIZE;
-	fseek(fp, offset, SEEK_END);
-	fread(memPage, sizeof(char), PAGE_SIZE, fp);
-	fHandle->curPagePos = fHandle->totalNumPages - 1;
-	fclose(fp);
+	return readBlock(fHandle->totalNumPages - 1, fHandle, memPage);
+}
+
+/***************************************************************
+ * Function Name: readBlocks
+ *
+ * Description: read numPages consecutive pages starting at pageNum, page i into memPages[i], with one vectored positioned read (preadv), split only every IOV_MAX pages or after a short read. With the io_uring backend the pages are read as separate requests kept in flight together, unless another thread is using the ring. Every page must exist.
+ *
+ * Parameters: PageNumber pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC readBlocks (PageNumber pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
+{
+	struct iovec iov[IOV_MAX];
+	int fd = getFileDescriptor(fHandle);
+	off_t offset = (off_t)pageNum * PAGE_SIZE;
+	size_t total = (size_t)numPages * PAGE_SIZE;
+	size_t done = 0;
+	ssize_t n;
+	int first, count, i;
+	RC rv;
+
+	if (pageNum < 0 || numPages < 0 || pageNum + numPages > fHandle->totalNumPages)
+		return RC_READ_NON_EXISTING_PAGE;
+	if (fd == -1)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if (numPages > 0 && isHeaderPage(fHandle, pageNum))
+		return RC_HEADER_PAGE;
+	if ((numPages > 0 && getMappedPage(fHandle, pageNum + numPages - 1) != NULL)
+			|| (isDirectIO(fHandle) && !pagesAligned(memPages, numPages))) {
+		//mapped pages are copied, direct I/O needs aligned buffers and readPageAt reads such pages through one
+		for (i = 0; i < numPages; i++) {
+			rv = readPageAt(fHandle, pageNum + i, memPages[i]);
+			if (rv != RC_OK)
+				return rv;
+		}
+		if (numPages > 0)
+			fHandle->curPagePos = pageNum + numPages - 1;
+		return RC_OK;
+	}
+	if (numPages > 1 && ringTransfer(fHandle, pageNum, NULL, numPages, memPages, 0, NULL, &rv)) {
+		if (rv == RC_OK)
+			fHandle->curPagePos = pageNum + numPages - 1;
+		return rv;
+	}
+
+	while (done < total) {
+		first = done / PAGE_SIZE;
+		count = (numPages - first < IOV_MAX) ? numPages - first : IOV_MAX;
+		for (i = 0; i < count; i++) {
+			iov[i].iov_base = memPages[first + i];
+			iov[i].iov_len = PAGE_SIZE;
+		}
+		iov[0].iov_base = (char *)iov[0].iov_base + done % PAGE_SIZE;		//resume inside a page after a short read.
+		iov[0].iov_len -= done % PAGE_SIZE;
+
+		n = preadv(fd, iov, count, offset + done);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			return RC_READ_NON_EXISTING_PAGE;
+		//a direct read cannot resume inside a page, a short one ended at the end of the file.
+		if (n > 0 && isDirectIO(fHandle) && (done + n) % PAGE_SIZE != 0) {
+			done += n;
+			n = 0;
+		}
+		if (n == 0) {
+			//short file, the rest of the pages are empty.
+			first = done / PAGE_SIZE;
+			memset(memPages[first] + done % PAGE_SIZE, 0, PAGE_SIZE - done % PAGE_SIZE);
+			for (i = first + 1; i < numPages; i++)
+				memset(memPages[i], 0, PAGE_SIZE);
+			break;
+		}
+		done += n;
+	}
+
+	if (numPages > 0)
+		fHandle->curPagePos = pageNum + numPages - 1;
 	return RC_OK;
 }
 
@@ -475,26 +649,214 @@ RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
  *   2016/2/2		Xincheng Yang			  modified some codes
  *
 ***************************************************************/
-RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	ensureCapacity (pageNum, fHandle);		//Make sure the program have enough capacity to write block.
-
-	FILE *fp;
+RC writeBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
 	RC rv;
 
-	fp = fopen(fHandle->fileName, "rb+");
-	if (fseek(fp, pageNum * PAGE_SIZE, SEEK_SET) != 0) {
-		rv = RC_READ_NON_EXISTING_PAGE;
-	} else if (fwrite(memPage, PAGE_SIZE, 1, fp) != 1) {
-		rv = RC_WRITE_FAILED;
-	} else {
+	if (pageNum < 0) {
+		return RC_WRITE_FAILED;
+	}
+	if (isHeaderPage(fHandle, pageNum)) {
+		return RC_HEADER_PAGE;
+	}
+
+	rv = writePageAt(fHandle, pageNum, memPage);
+	if (rv == RC_OK) {
+		if (pageNum >= fHandle->totalNumPages) {
+			fHandle->totalNumPages = pageNum + 1;		//Writing past the end grows the file.
+		}
 		fHandle->curPagePos = pageNum;		//Success write block, then curPagePos should be changed.
-		rv = RC_OK;
 	}
+	return rv;
+}
 
-	fclose(fp);
+/***************************************************************
+ * Function Name: writeBlocks
+ *
+ * Description: write numPages consecutive pages starting at pageNum, page i taken from memPages[i]. The pages go out as one vectored positioned write (pwritev), split only every IOV_MAX pages or after a short write. With the io_uring backend the pages are written as separate requests kept in flight together, unless another thread is using the ring.
+ *
+ * Parameters: PageNumber pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC writeBlocks (PageNumber pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+	struct iovec iov[IOV_MAX];
+	int fd = getFileDescriptor(fHandle);
+	off_t offset = (off_t)pageNum * PAGE_SIZE;
+	size_t total = (size_t)numPages * PAGE_SIZE;
+	size_t done = 0;
+	ssize_t n;
+	int first, count, i;
+	RC rv;
+
+	if (pageNum < 0 || numPages < 0) {
+		return RC_WRITE_FAILED;
+	}
+	if (fd == -1) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	if (numPages > 0 && isHeaderPage(fHandle, pageNum)) {
+		return RC_HEADER_PAGE;
+	}
+
+	if (isDirectIO(fHandle) && !pagesAligned(memPages, numPages)) {
+		//direct I/O needs aligned buffers, writePageAt writes such pages through one
+		for (i = 0; i < numPages; i++) {
+			rv = writePageAt(fHandle, pageNum + i, memPages[i]);
+			if (rv != RC_OK) {
+				return rv;
+			}
+		}
+		done = total;
+	} else if (numPages > 1 && ringTransfer(fHandle, pageNum, NULL, numPages, memPages, 1, NULL, &rv)) {
+		if (rv != RC_OK) {
+			return rv;
+		}
+		done = total;
+	}
+	while (done < total) {
+		first = done / PAGE_SIZE;
+		count = (numPages - first < IOV_MAX) ? numPages - first : IOV_MAX;
+		for (i = 0; i < count; i++) {
+			iov[i].iov_base = memPages[first + i];
+			iov[i].iov_len = PAGE_SIZE;
+		}
+		iov[0].iov_base = (char *)iov[0].iov_base + done % PAGE_SIZE;		//resume inside a page after a short write.
+		iov[0].iov_len -= done % PAGE_SIZE;
+
+		n = pwritev(fd, iov, count, offset + done);
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return RC_WRITE_FAILED;
+		}
+		done += n;
+	}
+
+	if (numPages > 0) {
+		if (pageNum + numPages > fHandle->totalNumPages) {
+			fHandle->totalNumPages = pageNum + numPages;
+		}
+		fHandle->curPagePos = pageNum + numPages - 1;
+	}
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: readPages
+ *
+ * Description: read numPages pages that need not be consecutive, pageNums[i] into memPages[i]. With the io_uring backend all of them are submitted as one batch, so the runs of a sorted set of pages are in flight together; otherwise, or while another thread uses the ring, each run of consecutive pages is one readBlocks. results, if not NULL, gets the outcome of each page, also when the call is refused before any I/O. Every page must exist.
+ *
+ * Parameters: const PageNumber *pageNums, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages, RC *results
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC readPages (const PageNumber *pageNums, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages, RC *results)
+{
+	SM_FileMgmtInfo *info;
+	int first, last, i;
+	RC rv, run;
+
+	if (numPages < 0)
+		return RC_READ_NON_EXISTING_PAGE;
+	rv = (getFileDescriptor(fHandle) == -1) ? RC_FILE_HANDLE_NOT_INIT : RC_OK;
+	for (i = 0; i < numPages && rv == RC_OK; i++) {
+		if (pageNums[i] < 0 || pageNums[i] >= fHandle->totalNumPages)
+			rv = RC_READ_NON_EXISTING_PAGE;
+		else if (isHeaderPage(fHandle, pageNums[i]))
+			rv = RC_HEADER_PAGE;
+	}
+	if (rv != RC_OK) {
+		//refused before any I/O, every page failed
+		for (i = 0; results != NULL && i < numPages; i++)
+			results[i] = rv;
+		return rv;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+
+	//mapped pages are copied and unaligned direct reads go through a bounce buffer, readBlocks does both
+	if (numPages > 1 && info->map == NULL && (!isDirectIO(fHandle) || pagesAligned(memPages, numPages))
+			&& ringTransfer(fHandle, 0, pageNums, numPages, memPages, 0, results, &rv)) {
+		if (rv == RC_OK)
+			fHandle->curPagePos = pageNums[numPages - 1];
+		return rv;
+	}
+
+	rv = RC_OK;
+	for (first = 0; first < numPages; first = last) {
+		for (last = first + 1; last < numPages && pageNums[last] == pageNums[last - 1] + 1; last++)
+			;
+		run = readBlocks(pageNums[first], last - first, fHandle, memPages + first);
+		if (run != RC_OK && rv == RC_OK)
+			rv = run;
+		for (i = first; results != NULL && i < last; i++)
+			results[i] = run;
+	}
 	return rv;
 }
 
+/***************************************************************
+ * Function Name: writePages
+ *
+ * Description: write numPages pages that need not be consecutive, memPages[i] to pageNums[i]. With the io_uring backend all of them are submitted as one batch, otherwise each run of consecutive pages is one writeBlocks. Writing past the end grows the file. results, if not NULL, gets the outcome of each page, also when the call is refused before any I/O.
+ *
+ * Parameters: const PageNumber *pageNums, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages, RC *results
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC writePages (const PageNumber *pageNums, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages, RC *results) {
+	int first, last, i;
+	RC rv, run;
+
+	if (numPages < 0) {
+		return RC_WRITE_FAILED;
+	}
+	rv = (getFileDescriptor(fHandle) == -1) ? RC_FILE_HANDLE_NOT_INIT : RC_OK;
+	for (i = 0; i < numPages && rv == RC_OK; i++) {
+		if (pageNums[i] < 0) {
+			rv = RC_WRITE_FAILED;
+		} else if (isHeaderPage(fHandle, pageNums[i])) {
+			rv = RC_HEADER_PAGE;
+		}
+	}
+	if (rv != RC_OK) {
+		//refused before any I/O, every page failed
+		for (i = 0; results != NULL && i < numPages; i++) {
+			results[i] = rv;
+		}
+		return rv;
+	}
+
+	if (numPages > 1 && (!isDirectIO(fHandle) || pagesAligned(memPages, numPages))
+			&& ringTransfer(fHandle, 0, pageNums, numPages, memPages, 1, results, &rv)) {
+		for (i = 0; i < numPages; i++) {
+			if ((results == NULL || results[i] == RC_OK) && pageNums[i] >= fHandle->totalNumPages) {
+				fHandle->totalNumPages = pageNums[i] + 1;
+			}
+		}
+		if (rv == RC_OK) {
+			fHandle->curPagePos = pageNums[numPages - 1];
+		}
+		return rv;
+	}
+
+	rv = RC_OK;
+	for (first = 0; first < numPages; first = last) {
+		for (last = first + 1; last < numPages && pageNums[last] == pageNums[last - 1] + 1; last++)
+			;
+		run = writeBlocks(pageNums[first], last - first, fHandle, memPages + first);
+		if (run != RC_OK && rv == RC_OK) {
+			rv = run;
+		}
+		for (i = first; results != NULL && i < last; i++) {
+			results[i] = run;
+		}
+	}
+	return rv;
+}
 
 /***************************************************************
  * Function Name: writeCurrentBlock
@@ -526,7 +888,7 @@ RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
 /***************************************************************
  * Function Name: appendEmptyBlock
  *
- * Description: Increase the number of pages in the file by one. The new last page should be filled with zero bytes.
+ * Description: Increase the number of pages in the file by one. The new last page should be filled with zero bytes. It is grown like ensureCapacity does, without writing the page.
  *
  * Parameters: int numberOfPages, SM_FileHandle *fHandle
  *
@@ -545,33 +907,36 @@ RC appendEmptyBlock (SM_FileHandle *fHandle) {
 		return RC_FILE_HANDLE_NOT_INIT;
 	}
 
-	FILE *fp;
-	char *allocData;
-	RC rv;
-
-	allocData = (char *)calloc(1, PAGE_SIZE);
-	fp = fopen(fHandle->fileName, "ab+");
+	return ensureCapacity(fHandle->totalNumPages + 1, fHandle);		//grows the file without writing the zero page.
+}
 
-	if (fwrite(allocData, PAGE_SIZE, 1, fp) != 1)
-	{
-		rv = RC_WRITE_FAILED;
-	} else {
-		fHandle -> totalNumPages += 1;
-		rv = RC_OK;
+/***************************************************************
+ * Function Name: appendEmptyBlocks
+ *
+ * Description: add numPages empty pages at the end of the file with one ensureCapacity, so a bulk load grows the file once instead of once per page.
+ *
+ * Parameters: SM_FileHandle *fHandle, int numPages
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC appendEmptyBlocks (SM_FileHandle *fHandle, int numPages) {
+	if (fHandle == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	if (numPages < 0) {
+		return RC_WRITE_FAILED;
 	}
 
-	free(allocData);
-	fclose(fp);
-
-	return  rv;
+	return ensureCapacity(fHandle->totalNumPages + numPages, fHandle);
 }
 
 /***************************************************************
  * Function Name: ensureCapacity
  *
- * Description: If the file has less than numberOfPages pages then increase the size to numberOfPages.
+ * Description: If the file has less than numberOfPages pages then increase the size to numberOfPages. The size is set with ftruncate and nothing is written, the new pages read as zeros; with SM_GROW_PREALLOCATE their blocks are reserved first (see setFileGrowth).
  *
- * Parameters: int numberOfPages, SM_FileHandle *fHandle
+ * Parameters: PageNumber numberOfPages, SM_FileHandle *fHandle
  *
  * Return: RC
  *
@@ -582,34 +947,1093 @@ RC appendEmptyBlock (SM_FileHandle *fHandle) {
  *   2016/2/1		Xincheng Yang             first time to implement the function
  *
 ***************************************************************/
-RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle) {
+RC ensureCapacity (PageNumber numberOfPages, SM_FileHandle *fHandle) {
 	if (fHandle == NULL) {
 		return RC_FILE_HANDLE_NOT_INIT;
 	}
 	if (fHandle -> totalNumPages >= numberOfPages) {
 		return RC_OK;
 	}
+	if (getFileDescriptor(fHandle) == -1) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
 
-	FILE *fp;
-	long allocCapacity;
-	char *allocData;
+	SM_FileMgmtInfo *info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
 	RC rv;
 
-	allocCapacity = (numberOfPages - fHandle -> totalNumPages) * PAGE_SIZE;
-	allocData = (char *)calloc(1, allocCapacity);
+	//reserve whole extents past the new end, the file size only moves with ftruncate below
+	rv = reserveCapacity(numberOfPages, fHandle);
+	if (rv != RC_OK) {
+		return rv;
+	}
+	//the new pages read as zeros, a sparse file gets their blocks when they are written
+	if (ftruncate(info->fd, (off_t)numberOfPages * PAGE_SIZE) != 0) {
+		return RC_WRITE_FAILED;
+	}
+	fHandle -> totalNumPages = numberOfPages;		//When growth success, totalNumPages should be changed to numberOfPages.
+
+	return RC_OK;
+}
 
-	fp = fopen(fHandle->fileName, "ab+");
+/***************************************************************
+ * Function Name: reserveCapacity
+ *
+ * Description: with SM_GROW_PREALLOCATE, reserve the blocks of the first numberOfPages pages with fallocate, in whole extents past SM_FileMgmtInfo.allocatedEnd, without changing the size of the file or totalNumPages. Callers that count pages ahead of the file, like pinNewPage, use it so the pages find their blocks reserved when they are written. Does nothing for a sparse file.
+ *
+ * Parameters: PageNumber numberOfPages, SM_FileHandle *fHandle
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC reserveCapacity (PageNumber numberOfPages, SM_FileHandle *fHandle) {
+	SM_FileMgmtInfo *info;
+	PageNumber end;
 
-	if (fwrite(allocData, allocCapacity, 1, fp) == 0)
-	{
-		rv = RC_WRITE_FAILED;
-	} else {
-		fHandle -> totalNumPages = numberOfPages;		//When write success, totalNumPages should be changed to numberOfPages.
-		rv = RC_OK;
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
 	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+
+	if (info->growth == SM_GROW_PREALLOCATE && numberOfPages > info->allocatedEnd) {
+		end = (numberOfPages + info->extentPages - 1) / info->extentPages * info->extentPages;
+		if (preallocatePages(info->fd, info->allocatedEnd, end - info->allocatedEnd) != 0) {
+			return RC_WRITE_FAILED;
+		}
+		info->allocatedEnd = end;
+	}
+	return RC_OK;
+}
 
-	free(allocData);
-	fclose(fp);
+/* I/O backend */
+
+/***************************************************************
+ * Function Name: setFileGrowth
+ *
+ * Description: choose how ensureCapacity, appendEmptyBlock and appendEmptyBlocks grow an open page file. Both modes set the new size with ftruncate and write nothing. SM_GROW_SPARSE leaves the new pages as holes. SM_GROW_PREALLOCATE also reserves their blocks with fallocate in steps of extentPages (SM_EXTENT_PAGES if 0 or less) past the end of the file, without changing its size, so later writes find the space allocated and contiguous. Returns RC_PREALLOCATE_NOT_AVAILABLE if the file system cannot preallocate, the file then stays sparse.
+ *
+ * Parameters: SM_FileHandle *fHandle, SM_GrowthMode mode, int extentPages
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC setFileGrowth (SM_FileHandle *fHandle, SM_GrowthMode mode, int extentPages) {
+	SM_FileMgmtInfo *info;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+
+	info->extentPages = extentPages > 0 ? extentPages : SM_EXTENT_PAGES;
+	if (mode == SM_GROW_PREALLOCATE) {
+		//the first page is reserved anyway, this only asks the file system whether it can
+		if (preallocatePages(info->fd, 0, 1) != 0) {
+			info->growth = SM_GROW_SPARSE;
+			return RC_PREALLOCATE_NOT_AVAILABLE;
+		}
+		if (info->allocatedEnd < 1) {
+			info->allocatedEnd = 1;
+		}
+	}
+	info->growth = mode;
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: setIOBackend
+ *
+ * Description: choose how readBlocks and writeBlocks reach an open page file. SM_IO_URING sets up an io_uring of SM_IO_QUEUE_DEPTH entries; if the kernel does not offer it the file keeps synchronous I/O and RC_IO_BACKEND_NOT_AVAILABLE is returned. Single pages are always read and written with pread and pwrite. No I/O on the file may run meanwhile.
+ *
+ * Parameters: SM_FileHandle *fHandle, SM_IOBackend backend
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC setIOBackend (SM_FileHandle *fHandle, SM_IOBackend backend) {
+	SM_FileMgmtInfo *info;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+
+	if (backend == SM_IO_SYNC) {
+		closeRing(info);
+		return RC_OK;
+	}
+	if (info->ring != NULL) {
+		return RC_OK;
+	}
+	return openRing(info);
+}
+
+/***************************************************************
+ * Function Name: getIOBackend
+ *
+ * Description: the I/O backend an open page file uses.
+ *
+ * Parameters: SM_FileHandle *fHandle
+ *
+ * Return: SM_IOBackend
+ *
+***************************************************************/
+SM_IOBackend getIOBackend (SM_FileHandle *fHandle) {
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL || ((SM_FileMgmtInfo *)fHandle->mgmtInfo)->ring == NULL) {
+		return SM_IO_SYNC;
+	}
+	return SM_IO_URING;
+}
+
+/***************************************************************
+ * Function Name: registerIOBuffers
+ *
+ * Description: register memory, such as the frames of a buffer pool, with the io_uring of a page file. Pages inside these buffers are read and written with fixed requests, which skip mapping the page for every request. The buffers replace those registered before and must stay valid until the file is closed or its backend changed. Without an io_uring, or if the kernel refuses (e.g. over the locked memory limit), RC_IO_BACKEND_NOT_AVAILABLE is returned and the pages are transferred as ordinary requests.
+ *
+ * Parameters: SM_FileHandle *fHandle, const struct iovec *buffers, int numBuffers
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC registerIOBuffers (SM_FileHandle *fHandle, const struct iovec *buffers, int numBuffers) {
+#ifdef SM_HAVE_IO_URING
+	struct SM_IORing *ring;
+	struct iovec *copy;
+	RC rv = RC_OK;
 
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	ring = ((SM_FileMgmtInfo *)fHandle->mgmtInfo)->ring;
+	if (ring == NULL || numBuffers <= 0) {
+		return RC_IO_BACKEND_NOT_AVAILABLE;
+	}
+	copy = (struct iovec *)malloc(numBuffers * sizeof(struct iovec));
+	if (copy == NULL) {
+		return RC_IO_BACKEND_NOT_AVAILABLE;
+	}
+	memcpy(copy, buffers, numBuffers * sizeof(struct iovec));
+
+	pthread_mutex_lock(&(ring->latch));
+	if (ring->numBuffers > 0) {
+		syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+		free(ring->buffers);
+		ring->buffers = NULL;
+		ring->numBuffers = 0;
+	}
+	if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, copy, numBuffers) == 0) {
+		ring->buffers = copy;
+		ring->numBuffers = numBuffers;
+	} else {
+		free(copy);
+		rv = RC_IO_BACKEND_NOT_AVAILABLE;
+	}
+	pthread_mutex_unlock(&(ring->latch));
 	return rv;
+#else
+	(void)fHandle;
+	(void)buffers;
+	(void)numBuffers;
+	return RC_IO_BACKEND_NOT_AVAILABLE;
+#endif
 }
+
+/***************************************************************
+ * Function Name: setDirectIO
+ *
+ * Description: switch an open page file to O_DIRECT (direct != 0) or back. In direct mode pages move between the disk and the caller's buffers without a copy in the OS page cache, whose copies of the file are dropped. Transfers are whole pages at page aligned offsets; buffers that are not page aligned go through an aligned bounce page, so only aligned buffers, such as the frames of a buffer pool, gain. Returns RC_DIRECT_IO_NOT_AVAILABLE if the file system does not support O_DIRECT, the file then stays buffered.
+ *
+ * Parameters: SM_FileHandle *fHandle, int direct
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC setDirectIO (SM_FileHandle *fHandle, int direct) {
+	SM_FileMgmtInfo *info;
+	int flags;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+
+	flags = fcntl(info->fd, F_GETFL);
+	if (flags == -1) {
+		return RC_DIRECT_IO_NOT_AVAILABLE;
+	}
+	flags = direct ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+	if (fcntl(info->fd, F_SETFL, flags) == -1) {
+		return RC_DIRECT_IO_NOT_AVAILABLE;
+	}
+	info->direct = direct ? 1 : 0;
+	if (direct) {
+		//the cached pages would only hold a second copy now
+		fdatasync(info->fd);
+		posix_fadvise(info->fd, 0, 0, POSIX_FADV_DONTNEED);
+	}
+	return RC_OK;
+}
+
+/* memory-mapped reads */
+
+/***************************************************************
+ * Function Name: mapPageFile
+ *
+ * Description: map an open page file read-only and pass pattern on to madvise. The pages of the file are then readable in place through getMappedPage, and readBlock and the other reads copy from the mapping instead of calling pread. Pages appended later are read with pread. Calling it again on a mapped file only changes the advice.
+ *
+ * Parameters: SM_FileHandle *fHandle, SM_AccessPattern pattern
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC mapPageFile (SM_FileHandle *fHandle, SM_AccessPattern pattern) {
+	SM_FileMgmtInfo *info;
+	struct stat st;
+	long systemPage = sysconf(_SC_PAGESIZE);
+	int advice;
+	void *map;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	advice = pattern == SM_ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : (pattern == SM_ACCESS_RANDOM ? MADV_RANDOM : MADV_NORMAL);
+
+	if (info->map == NULL) {
+		if (fstat(info->fd, &st) != 0) {
+			return RC_MAP_FAILED;
+		}
+		if (st.st_size == 0) {
+			return RC_OK;		//nothing to map, every read goes to the file.
+		}
+		//only the mapping length is rounded to whole system pages, a partial last page is read with pread
+		if (systemPage <= 0) {
+			systemPage = PAGE_SIZE;
+		}
+		info->mapSize = (size_t)((st.st_size + systemPage - 1) / systemPage * systemPage);
+		map = mmap(NULL, info->mapSize, PROT_READ, MAP_SHARED, info->fd, 0);
+		if (map == MAP_FAILED) {
+			info->mapSize = 0;
+			return RC_MAP_FAILED;
+		}
+		info->map = (char *)map;
+		info->mapPages = (PageNumber)(st.st_size / PAGE_SIZE);
+	}
+	madvise(info->map, info->mapSize, advice);
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: unmapPageFile
+ *
+ * Description: remove the mapping made by mapPageFile, if any. Pointers from getMappedPage become invalid.
+ *
+ * Parameters: SM_FileHandle *fHandle
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC unmapPageFile (SM_FileHandle *fHandle) {
+	SM_FileMgmtInfo *info;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	if (info->map != NULL) {
+		munmap(info->map, info->mapSize);
+	}
+	info->map = NULL;
+	info->mapSize = 0;
+	info->mapPages = 0;
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: getMappedPage
+ *
+ * Description: the address of page pageNum inside the mapping of a mapped file, or NULL if the file is not mapped or the page is not in the mapping. The page must not be written through it.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum
+ *
+ * Return: SM_PageHandle
+ *
+***************************************************************/
+SM_PageHandle getMappedPage (SM_FileHandle *fHandle, PageNumber pageNum) {
+	SM_FileMgmtInfo *info;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return NULL;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	if (info->map == NULL || pageNum < 0 || pageNum >= info->mapPages) {
+		return NULL;
+	}
+	return info->map + (size_t)pageNum * PAGE_SIZE;
+}
+
+/***************************************************************
+ * Function Name: allocatePage
+ *
+ * Description: hand out an empty page of a file created with createPageFileWithFreeMap. The lowest free page is reused and zeroed before the file is extended; only when no page is free is a page added at the end, like appendEmptyBlock does.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber *pageNum
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC allocatePage (SM_FileHandle *fHandle, PageNumber *pageNum) {
+	SM_FileMgmtInfo *info;
+	PageNumber end, byte, page;
+	unsigned char bits;
+	RC rv;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	if (info->freeMap == NULL) {
+		return RC_NO_FREE_MAP;
+	}
+
+	end = freeMapCapacity(info) < fHandle->totalNumPages ? freeMapCapacity(info) : fHandle->totalNumPages;
+	for (byte = info->freeHint / 8; info->numFreePages > 0 && byte * 8 < end; byte++) {
+		bits = (unsigned char)info->freeMap[SM_FREE_MAP_HEADER + byte];
+		if (bits == 0) {
+			continue;
+		}
+		page = byte * 8 + __builtin_ctz(bits);
+		info->freeHint = page;
+		if (page >= end) {
+			break;
+		}
+		//zeroed first, a page that could not be cleared stays free
+		rv = writePageAt(fHandle, page, zeroPage);
+		if (rv == RC_OK) {
+			rv = writeFreeMapBit(fHandle, page, 0);
+		}
+		if (rv == RC_OK) {
+			*pageNum = page;
+		}
+		return rv;
+	}
+
+	page = fHandle->totalNumPages;
+	rv = ensureCapacity(page + 1, fHandle);
+	if (rv == RC_OK) {
+		*pageNum = page;
+	}
+	return rv;
+}
+
+/***************************************************************
+ * Function Name: freePage
+ *
+ * Description: mark a page of a file created with createPageFileWithFreeMap as free, so allocatePage hands it out again. With punchHole the blocks of the page are given back to the file system (FALLOC_FL_PUNCH_HOLE) and it reads as zeros; where the file system cannot punch holes the page just keeps its blocks. The size of the file does not change.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum, int punchHole
+ *
+ * Return: RC
+ *
+***************************************************************/
+RC freePage (SM_FileHandle *fHandle, PageNumber pageNum, int punchHole) {
+	SM_FileMgmtInfo *info;
+	RC rv;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	if (info->freeMap == NULL) {
+		return RC_NO_FREE_MAP;
+	}
+	if (pageNum < 0 || pageNum >= fHandle->totalNumPages) {
+		return RC_READ_NON_EXISTING_PAGE;
+	}
+	if (pageNum >= freeMapCapacity(info)) {
+		return RC_FREE_MAP_FULL;
+	}
+	if (pageNum < info->freeMapPages || (info->freeMap[SM_FREE_MAP_HEADER + pageNum / 8] & (1 << (pageNum % 8))) != 0) {
+		return RC_PAGE_NOT_ALLOCATED;
+	}
+
+	rv = writeFreeMapBit(fHandle, pageNum, 1);
+	if (rv != RC_OK) {
+		return rv;
+	}
+	if (pageNum < info->freeHint) {
+		info->freeHint = pageNum;
+	}
+	if (punchHole) {
+		punchPage(info->fd, pageNum);
+	}
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: nextAllocatedPage
+ *
+ * Description: the first page at or after pageNum that holds data, skipping free pages and the pages of the free-space map, so a scan does not walk dead pages. Returns -1 past the last page. In a file without a free-space map every page holds data.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum
+ *
+ * Return: PageNumber
+ *
+***************************************************************/
+PageNumber nextAllocatedPage (SM_FileHandle *fHandle, PageNumber pageNum) {
+	SM_FileMgmtInfo *info;
+	PageNumber capacity;
+
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return -1;
+	}
+	info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	if (pageNum < info->freeMapPages) {
+		pageNum = info->freeMapPages;
+	}
+	if (info->freeMap != NULL && info->numFreePages > 0) {
+		capacity = freeMapCapacity(info);
+		while (pageNum < fHandle->totalNumPages && pageNum < capacity) {
+			if (pageNum % 8 == 0 && (unsigned char)info->freeMap[SM_FREE_MAP_HEADER + pageNum / 8] == 0xFF) {
+				pageNum += 8;		//eight free pages in a row.
+			} else if ((info->freeMap[SM_FREE_MAP_HEADER + pageNum / 8] & (1 << (pageNum % 8))) != 0) {
+				pageNum++;
+			} else {
+				break;
+			}
+		}
+	}
+	return pageNum < fHandle->totalNumPages ? pageNum : -1;
+}
+
+/***************************************************************
+ * Function Name: getNumFreePages
+ *
+ * Description: the number of free pages allocatePage can reuse, 0 in a file without a free-space map.
+ *
+ * Parameters: SM_FileHandle *fHandle
+ *
+ * Return: PageNumber
+ *
+***************************************************************/
+PageNumber getNumFreePages (SM_FileHandle *fHandle) {
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return 0;
+	}
+	return ((SM_FileMgmtInfo *)fHandle->mgmtInfo)->numFreePages;
+}
+
+/***************************************************************
+ * Function Name: getNumHeaderPages
+ *
+ * Description: the number of pages at the start of the file that hold the free-space map, 0 in a file without one. They are read and written only through the map functions; readBlock, writeBlock and the other public reads and writes refuse them with RC_HEADER_PAGE.
+ *
+ * Parameters: SM_FileHandle *fHandle
+ *
+ * Return: int
+ *
+***************************************************************/
+int getNumHeaderPages (SM_FileHandle *fHandle) {
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return 0;
+	}
+	return ((SM_FileMgmtInfo *)fHandle->mgmtInfo)->freeMapPages;
+}
+
+/***************************************************************
+ * Function Name: getFileDescriptor
+ *
+ * Description: return the descriptor kept open in fHandle->mgmtInfo, or -1 if the file is not open.
+ *
+ * Parameters: SM_FileHandle *fHandle
+ *
+ * Return: int
+ *
+***************************************************************/
+static int getFileDescriptor (SM_FileHandle *fHandle) {
+	if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+		return -1;
+	}
+	return ((SM_FileMgmtInfo *)fHandle->mgmtInfo)->fd;
+}
+
+/***************************************************************
+ * Function Name: isDirectIO
+ *
+ * Description: whether fHandle is an open file in direct mode.
+ *
+ * Parameters: SM_FileHandle *fHandle
+ *
+ * Return: int
+ *
+***************************************************************/
+static int isDirectIO (SM_FileHandle *fHandle) {
+	return fHandle != NULL && fHandle->mgmtInfo != NULL && ((SM_FileMgmtInfo *)fHandle->mgmtInfo)->direct;
+}
+
+/***************************************************************
+ * Function Name: pagesAligned
+ *
+ * Description: whether every buffer of memPages starts on a page boundary, as direct transfers need.
+ *
+ * Parameters: SM_PageHandle *memPages, int numPages
+ *
+ * Return: int
+ *
+***************************************************************/
+static int pagesAligned (SM_PageHandle *memPages, int numPages) {
+	int i;
+
+	for (i = 0; i < numPages; i++) {
+		if ((uintptr_t)memPages[i] % PAGE_SIZE != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/***************************************************************
+ * Function Name: isHeaderPage
+ *
+ * Description: whether pageNum holds the free-space map of fHandle. The public reads and writes refuse such pages with RC_HEADER_PAGE; loadFreeMap and writeFreeMapBit go through readPageAt and writePageAt.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum
+ *
+ * Return: int
+ *
+***************************************************************/
+static int isHeaderPage (SM_FileHandle *fHandle, PageNumber pageNum) {
+	return fHandle != NULL && fHandle->mgmtInfo != NULL && pageNum >= 0
+			&& pageNum < ((SM_FileMgmtInfo *)fHandle->mgmtInfo)->freeMapPages;
+}
+
+/***************************************************************
+ * Function Name: readPageAt
+ *
+ * Description: read page pageNum into memPage with a single positioned read, or a copy from the mapping of a mapped file. Bytes past the end of the file read as zero. A file in direct mode reads an unaligned memPage through an aligned bounce page.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum, SM_PageHandle memPage
+ *
+ * Return: RC
+ *
+***************************************************************/
+static RC readPageAt (SM_FileHandle *fHandle, PageNumber pageNum, SM_PageHandle memPage) {
+	int fd = getFileDescriptor(fHandle);
+	int direct = isDirectIO(fHandle);
+	off_t offset = (off_t)pageNum * PAGE_SIZE;
+	char *target = memPage;
+	char *bounce = NULL;
+	ssize_t n;
+	size_t done = 0;
+
+	if (fd == -1) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	if (getMappedPage(fHandle, pageNum) != NULL) {
+		memcpy(memPage, getMappedPage(fHandle, pageNum), PAGE_SIZE);		//a mapped page is copied without a system call.
+		return RC_OK;
+	}
+	if (direct && (uintptr_t)memPage % PAGE_SIZE != 0) {
+		if (posix_memalign((void **)&bounce, PAGE_SIZE, PAGE_SIZE) != 0) {
+			return RC_READ_NON_EXISTING_PAGE;
+		}
+		target = bounce;
+	}
+
+	while (done < PAGE_SIZE) {
+		n = pread(fd, target + done, PAGE_SIZE - done, offset + done);
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+		if (n == -1) {
+			free(bounce);
+			return RC_READ_NON_EXISTING_PAGE;
+		}
+		if (n == 0 || (direct && n < (ssize_t)(PAGE_SIZE - done))) {
+			//short file, the rest of the page is empty; a direct read cannot resume inside the page.
+			memset(target + done + (n > 0 ? n : 0), 0, PAGE_SIZE - done - (n > 0 ? n : 0));
+			break;
+		}
+		done += n;
+	}
+	if (bounce != NULL) {
+		memcpy(memPage, bounce, PAGE_SIZE);
+		free(bounce);
+	}
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: writePageAt
+ *
+ * Description: write memPage to page pageNum with a single positioned write. A file in direct mode writes an unaligned memPage through an aligned bounce page.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum, const char *memPage
+ *
+ * Return: RC
+ *
+***************************************************************/
+static RC writePageAt (SM_FileHandle *fHandle, PageNumber pageNum, const char *memPage) {
+	int fd = getFileDescriptor(fHandle);
+	off_t offset = (off_t)pageNum * PAGE_SIZE;
+	const char *source = memPage;
+	char *bounce = NULL;
+	ssize_t n;
+	size_t done = 0;
+
+	if (fd == -1) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	if (isDirectIO(fHandle) && (uintptr_t)memPage % PAGE_SIZE != 0) {
+		if (posix_memalign((void **)&bounce, PAGE_SIZE, PAGE_SIZE) != 0) {
+			return RC_WRITE_FAILED;
+		}
+		memcpy(bounce, memPage, PAGE_SIZE);
+		source = bounce;
+	}
+
+	while (done < PAGE_SIZE) {
+		n = pwrite(fd, source + done, PAGE_SIZE - done, offset + done);
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			free(bounce);
+			return RC_WRITE_FAILED;
+		}
+		done += n;
+	}
+	free(bounce);
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: adviseReadAhead
+ *
+ * Description: readNextBlock is about to read pageNum. Once the scan gets within half a window of the pages already advised, ask the kernel to read the next SM_READ_AHEAD_PAGES pages in the background, so a sequential scan rarely waits for the disk.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum
+ *
+ * Return: void
+ *
+***************************************************************/
+static void adviseReadAhead (SM_FileHandle *fHandle, PageNumber pageNum) {
+	SM_FileMgmtInfo *info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	PageNumber first, last;
+
+	if (info == NULL || info->direct) {
+		return;
+	}
+	//still well inside the advised window; an end past the window is left from a scan further on
+	if (pageNum + SM_READ_AHEAD_PAGES / 2 < info->readAheadEnd && info->readAheadEnd <= pageNum + SM_READ_AHEAD_PAGES) {
+		return;
+	}
+	first = (info->readAheadEnd > pageNum && info->readAheadEnd <= pageNum + SM_READ_AHEAD_PAGES) ? info->readAheadEnd : pageNum;
+	last = pageNum + SM_READ_AHEAD_PAGES;
+	if (last > fHandle->totalNumPages) {
+		last = fHandle->totalNumPages;
+	}
+	if (first < last) {
+		posix_fadvise(info->fd, (off_t)first * PAGE_SIZE, (off_t)(last - first) * PAGE_SIZE, POSIX_FADV_WILLNEED);
+	}
+	info->readAheadEnd = pageNum + SM_READ_AHEAD_PAGES;
+}
+
+/***************************************************************
+ * Function Name: preallocatePages
+ *
+ * Description: reserve the blocks of numPages pages from pageNum with fallocate, keeping the size of the file. Returns -1 with errno set where the file system or the platform cannot do it.
+ *
+ * Parameters: int fd, PageNumber pageNum, PageNumber numPages
+ *
+ * Return: int
+ *
+***************************************************************/
+static int preallocatePages (int fd, PageNumber pageNum, PageNumber numPages) {
+#ifdef FALLOC_FL_KEEP_SIZE
+	int rv;
+
+	do {
+		rv = fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t)pageNum * PAGE_SIZE, (off_t)numPages * PAGE_SIZE);
+	} while (rv == -1 && errno == EINTR);
+	return rv;
+#else
+	(void)fd;
+	(void)pageNum;
+	(void)numPages;
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
+/***************************************************************
+ * Function Name: punchPage
+ *
+ * Description: give the blocks of a page back to the file system, keeping the size of the file; the page then reads as zeros. Returns -1 with errno set where the file system or the platform cannot do it.
+ *
+ * Parameters: int fd, PageNumber pageNum
+ *
+ * Return: int
+ *
+***************************************************************/
+static int punchPage (int fd, PageNumber pageNum) {
+#ifdef FALLOC_FL_PUNCH_HOLE
+	int rv;
+
+	do {
+		rv = fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)pageNum * PAGE_SIZE, PAGE_SIZE);
+	} while (rv == -1 && errno == EINTR);
+	return rv;
+#else
+	(void)fd;
+	(void)pageNum;
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
+/***************************************************************
+ * Function Name: loadFreeMap
+ *
+ * Description: read the free-space map of a page file that has one into SM_FileMgmtInfo.freeMap and count its free pages. A file without the magic at its start is left without a map.
+ *
+ * Parameters: SM_FileHandle *fHandle
+ *
+ * Return: RC
+ *
+***************************************************************/
+static RC loadFreeMap (SM_FileHandle *fHandle) {
+	SM_FileMgmtInfo *info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	char header[SM_FREE_MAP_HEADER];
+	int32_t mapPages;
+	PageNumber byte, bytes;
+	int i;
+	RC rv;
+
+	if (fHandle->totalNumPages < 1 || pread(info->fd, header, SM_FREE_MAP_HEADER, 0) != SM_FREE_MAP_HEADER
+			|| memcmp(header, SM_FREE_MAP_MAGIC, 8) != 0) {
+		return RC_OK;
+	}
+	memcpy(&mapPages, header + 8, sizeof(int32_t));
+	if (mapPages < 1 || mapPages > fHandle->totalNumPages) {
+		return RC_READ_NON_EXISTING_PAGE;
+	}
+
+	//page aligned, so the map pages can be written back in direct mode
+	if (posix_memalign((void **)&(info->freeMap), PAGE_SIZE, (size_t)mapPages * PAGE_SIZE) != 0) {
+		info->freeMap = NULL;
+		return RC_MEMORY_ALLOCATION_FAIL;
+	}
+	for (i = 0; i < mapPages; i++) {
+		rv = readPageAt(fHandle, i, info->freeMap + (size_t)i * PAGE_SIZE);
+		if (rv != RC_OK) {
+			free(info->freeMap);
+			info->freeMap = NULL;
+			return rv;
+		}
+	}
+	info->freeMapPages = mapPages;
+	bytes = (PageNumber)mapPages * PAGE_SIZE - SM_FREE_MAP_HEADER;
+	for (byte = 0; byte < bytes; byte++) {
+		info->numFreePages += __builtin_popcount((unsigned char)info->freeMap[SM_FREE_MAP_HEADER + byte]);
+	}
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: freeMapCapacity
+ *
+ * Description: the number of pages the free-space map has a bit for.
+ *
+ * Parameters: SM_FileMgmtInfo *info
+ *
+ * Return: PageNumber
+ *
+***************************************************************/
+static PageNumber freeMapCapacity (SM_FileMgmtInfo *info) {
+	return ((PageNumber)info->freeMapPages * PAGE_SIZE - SM_FREE_MAP_HEADER) * 8;
+}
+
+/***************************************************************
+ * Function Name: writeFreeMapBit
+ *
+ * Description: set the bit of pageNum in the free-space map (isFree != 0) or clear it, write the map page that holds it and keep numFreePages. If the write fails the bit is restored.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum, int isFree
+ *
+ * Return: RC
+ *
+***************************************************************/
+static RC writeFreeMapBit (SM_FileHandle *fHandle, PageNumber pageNum, int isFree) {
+	SM_FileMgmtInfo *info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	char *byte = info->freeMap + SM_FREE_MAP_HEADER + pageNum / 8;
+	char old = *byte;
+	PageNumber mapPage = (SM_FREE_MAP_HEADER + pageNum / 8) / PAGE_SIZE;
+	RC rv;
+
+	*byte = isFree ? (char)(old | (1 << (pageNum % 8))) : (char)(old & ~(1 << (pageNum % 8)));
+	rv = writePageAt(fHandle, mapPage, info->freeMap + (size_t)mapPage * PAGE_SIZE);
+	if (rv != RC_OK) {
+		*byte = old;
+		return rv;
+	}
+	info->numFreePages += isFree ? 1 : -1;
+	return RC_OK;
+}
+
+#ifdef SM_HAVE_IO_URING
+
+/***************************************************************
+ * Function Name: openRing
+ *
+ * Description: set up an io_uring for an open page file and map its submission queue, completion queue and submission entries.
+ *
+ * Parameters: SM_FileMgmtInfo *info
+ *
+ * Return: RC
+ *
+***************************************************************/
+static RC openRing (SM_FileMgmtInfo *info) {
+	struct io_uring_params params;
+	struct SM_IORing *ring;
+	int fd;
+
+	memset(&params, 0, sizeof(params));
+	fd = syscall(__NR_io_uring_setup, SM_IO_QUEUE_DEPTH, &params);
+	if (fd < 0) {
+		return RC_IO_BACKEND_NOT_AVAILABLE;
+	}
+	ring = (struct SM_IORing *)calloc(1, sizeof(struct SM_IORing));
+	if (ring == NULL || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+		free(ring);
+		close(fd);
+		return RC_IO_BACKEND_NOT_AVAILABLE;
+	}
+	ring->fd = fd;
+	ring->numEntries = params.sq_entries;
+	ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		//both queues live in one mapping
+		if (ring->cqRingSize > ring->sqRingSize) {
+			ring->sqRingSize = ring->cqRingSize;
+		}
+		ring->cqRingSize = ring->sqRingSize;
+	}
+
+	ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (ring->sqRing != MAP_FAILED && (params.features & IORING_FEAT_SINGLE_MMAP)) {
+		ring->cqRing = ring->sqRing;
+	} else if (ring->sqRing != MAP_FAILED) {
+		ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	}
+	if (ring->sqRing != MAP_FAILED && ring->cqRing != MAP_FAILED) {
+		ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	}
+	if (ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED) {
+		if (ring->sqRing != MAP_FAILED) {
+			munmap(ring->sqRing, ring->sqRingSize);
+		}
+		if (ring->cqRing != MAP_FAILED && ring->cqRing != NULL && ring->cqRing != ring->sqRing) {
+			munmap(ring->cqRing, ring->cqRingSize);
+		}
+		free(ring);
+		close(fd);
+		return RC_IO_BACKEND_NOT_AVAILABLE;
+	}
+
+	ring->sqHead = (unsigned *)((char *)ring->sqRing + params.sq_off.head);
+	ring->sqTail = (unsigned *)((char *)ring->sqRing + params.sq_off.tail);
+	ring->sqMask = (unsigned *)((char *)ring->sqRing + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned *)((char *)ring->sqRing + params.sq_off.array);
+	ring->cqHead = (unsigned *)((char *)ring->cqRing + params.cq_off.head);
+	ring->cqTail = (unsigned *)((char *)ring->cqRing + params.cq_off.tail);
+	ring->cqMask = (unsigned *)((char *)ring->cqRing + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)((char *)ring->cqRing + params.cq_off.cqes);
+	pthread_mutex_init(&(ring->latch), NULL);
+	info->ring = ring;
+	return RC_OK;
+}
+
+/***************************************************************
+ * Function Name: closeRing
+ *
+ * Description: unmap and close the io_uring of a page file, if it has one. Its registered buffers are released with it.
+ *
+ * Parameters: SM_FileMgmtInfo *info
+ *
+ * Return: void
+ *
+***************************************************************/
+static void closeRing (SM_FileMgmtInfo *info) {
+	struct SM_IORing *ring = info->ring;
+
+	if (ring == NULL) {
+		return;
+	}
+	munmap(ring->sqes, ring->sqesSize);
+	if (ring->cqRing != ring->sqRing) {
+		munmap(ring->cqRing, ring->cqRingSize);
+	}
+	munmap(ring->sqRing, ring->sqRingSize);
+	close(ring->fd);
+	pthread_mutex_destroy(&(ring->latch));
+	free(ring->buffers);
+	free(ring);
+	info->ring = NULL;
+}
+
+/***************************************************************
+ * Function Name: ringBuffer
+ *
+ * Description: the registered buffer holding a whole page at memPage, or -1.
+ *
+ * Parameters: struct SM_IORing *ring, const char *memPage
+ *
+ * Return: int
+ *
+***************************************************************/
+static int ringBuffer (struct SM_IORing *ring, const char *memPage) {
+	const char *base;
+	int i;
+
+	for (i = 0; i < ring->numBuffers; i++) {
+		base = (const char *)ring->buffers[i].iov_base;
+		if (memPage >= base && memPage + PAGE_SIZE <= base + ring->buffers[i].iov_len) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/***************************************************************
+ * Function Name: ringTransfer
+ *
+ * Description: read or write numPages pages through the io_uring of the file, one request per page with up to the ring size in flight. Page i is pageNums[i], or pageNum + i if pageNums is NULL, so scattered pages go out in one batch as well. Completions are reaped from the mapped queue and the kernel is only entered to submit or when nothing has completed yet. A page whose request failed or was short, such as a read at the end of the file, is redone synchronously; every other page is counted in ringPages. results, if not NULL, gets the outcome of each page and result the first error. Returns 0 without any I/O if the file has no ring or another thread is using it, the caller then takes the synchronous path.
+ *
+ * Parameters: SM_FileHandle *fHandle, PageNumber pageNum, const PageNumber *pageNums, int numPages, SM_PageHandle *memPages, int write, RC *results, RC *result
+ *
+ * Return: int
+ *
+***************************************************************/
+static int ringTransfer (SM_FileHandle *fHandle, PageNumber pageNum, const PageNumber *pageNums, int numPages, SM_PageHandle *memPages, int write, RC *results, RC *result) {
+	SM_FileMgmtInfo *info = (SM_FileMgmtInfo *)fHandle->mgmtInfo;
+	struct SM_IORing *ring = info->ring;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	unsigned tail, head, slot;
+	PageNumber at;
+	int next = 0, inFlight = 0, toSubmit = 0, page, buffer, wait;
+	long n;
+	RC rv = RC_OK, redone;
+
+	if (ring == NULL || pthread_mutex_trylock(&(ring->latch)) != 0) {
+		return 0;
+	}
+	if (results != NULL) {
+		for (page = 0; page < numPages; page++) {
+			results[page] = RC_OK;
+		}
+	}
+
+	while (next < numPages || inFlight > 0) {
+		tail = *(ring->sqTail);
+		while (next < numPages && inFlight + toSubmit < (int)ring->numEntries) {
+			slot = tail & *(ring->sqMask);
+			sqe = ring->sqes + slot;
+			memset(sqe, 0, sizeof(struct io_uring_sqe));
+			buffer = ringBuffer(ring, memPages[next]);
+			if (buffer >= 0) {
+				sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+				sqe->buf_index = buffer;
+			} else {
+				sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+			}
+			sqe->fd = info->fd;
+			sqe->off = (unsigned long long)(pageNums != NULL ? pageNums[next] : pageNum + next) * PAGE_SIZE;
+			sqe->addr = (unsigned long)memPages[next];
+			sqe->len = PAGE_SIZE;
+			sqe->user_data = next;
+			ring->sqArray[slot] = slot;
+			tail++;
+			next++;
+			toSubmit++;
+		}
+		__atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+
+		head = *(ring->cqHead);
+		wait = head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+		if (toSubmit > 0 || wait) {
+			n = syscall(__NR_io_uring_enter, ring->fd, toSubmit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+			if (n > 0) {
+				toSubmit -= n;
+				inFlight += n;
+			} else if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+				//the kernel took none of the queued requests, take them back and do them synchronously
+				__atomic_store_n(ring->sqTail, tail - toSubmit, __ATOMIC_RELEASE);
+				for (page = next - toSubmit; page < numPages; page++) {
+					at = (pageNums != NULL) ? pageNums[page] : pageNum + page;
+					redone = write ? writePageAt(fHandle, at, memPages[page]) : readPageAt(fHandle, at, memPages[page]);
+					if (redone != RC_OK) {
+						rv = redone;
+						if (results != NULL) {
+							results[page] = redone;
+						}
+					}
+				}
+				next = numPages;
+				toSubmit = 0;
+			}
+		}
+
+		while (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+			cqe = ring->cqes + (head & *(ring->cqMask));
+			page = (int)cqe->user_data;
+			n = cqe->res;
+			head++;
+			inFlight--;
+			if (n == PAGE_SIZE) {
+				info->ringPages++;
+			} else {
+				at = (pageNums != NULL) ? pageNums[page] : pageNum + page;
+				redone = write ? writePageAt(fHandle, at, memPages[page]) : readPageAt(fHandle, at, memPages[page]);
+				if (redone != RC_OK) {
+					rv = redone;
+					if (results != NULL) {
+						results[page] = redone;
+					}
+				}
+			}
+		}
+		__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&(ring->latch));
+	*result = rv;
+	return 1;
+}
+
+#else
+
+static RC openRing (SM_FileMgmtInfo *info) {
+	(void)info;
+	return RC_IO_BACKEND_NOT_AVAILABLE;
+}
+
+static void closeRing (SM_FileMgmtInfo *info) {
+	(void)info;
+}
+
+static int ringTransfer (SM_FileHandle *fHandle, PageNumber pageNum, const PageNumber *pageNums, int numPages, SM_PageHandle *memPages, int write, RC *results, RC *result) {
+	(void)fHandle;
+	(void)pageNum;
+	(void)pageNums;
+	(void)numPages;
+	(void)memPages;
+	(void)write;
+	(void)results;
+	(void)result;
+	return 0;
+}
+
+#endif
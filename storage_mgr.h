@@ -1,20 +1,71 @@
 #ifndef STORAGE_MGR_H
 #define STORAGE_MGR_H
 
+#include <sys/uio.h>
 #include "dberror.h"
 
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
+/* 64-bit, so page files can grow far past 2 GB (524288 pages) */
+typedef long long PageNumber;
+
 typedef struct SM_FileHandle {
   char *fileName;
-  int totalNumPages;
-  int curPagePos;
+  PageNumber totalNumPages;
+  PageNumber curPagePos;
   void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+/* how readBlocks, writeBlocks, readPages and writePages reach the page file, see setIOBackend */
+typedef enum SM_IOBackend {
+  SM_IO_SYNC = 0, /* one preadv or pwritev per run of pages */
+  SM_IO_URING = 1 /* one io_uring request per page, SM_IO_QUEUE_DEPTH in flight, a readPages or writePages call is one batch */
+} SM_IOBackend;
+
+/* access pattern of a mapped page file, passed on to madvise */
+typedef enum SM_AccessPattern {
+  SM_ACCESS_NORMAL = 0,
+  SM_ACCESS_SEQUENTIAL = 1, /* read ahead aggressively, drop pages behind */
+  SM_ACCESS_RANDOM = 2 /* no read-ahead around a faulted page */
+} SM_AccessPattern;
+
+/* how ensureCapacity and appendEmptyBlock grow a page file, see setFileGrowth */
+typedef enum SM_GrowthMode {
+  SM_GROW_SPARSE = 0, /* ftruncate, blocks are allocated when the pages are written */
+  SM_GROW_PREALLOCATE = 1 /* fallocate whole extents past the end of the file as well */
+} SM_GrowthMode;
+
+/* kept in SM_FileHandle.mgmtInfo while the page file is open */
+typedef struct SM_FileMgmtInfo {
+  int fd; /* descriptor used for positioned reads and writes */
+  PageNumber readAheadEnd; /* first page readNextBlock has not yet asked the kernel to read ahead */
+  struct SM_IORing *ring; /* io_uring of the file, NULL for synchronous I/O */
+  PageNumber ringPages; /* pages the ring has read or written since the file was opened */
+  int direct; /* set by setDirectIO, pages bypass the OS page cache */
+  char *map; /* read-only mapping of the file made by mapPageFile, or NULL */
+  size_t mapSize; /* length of map, rounded up to whole system pages */
+  PageNumber mapPages; /* whole pages of the file inside map, a partial last page is not one */
+  SM_GrowthMode growth; /* set by setFileGrowth */
+  int extentPages; /* pages preallocated at a time in SM_GROW_PREALLOCATE */
+  PageNumber allocatedEnd; /* pages with blocks reserved by fallocate, may run past totalNumPages */
+  char *freeMap; /* header pages with the free-space bitmap, NULL if the file has none */
+  int freeMapPages; /* header pages of freeMap, pages 0 to freeMapPages - 1 of the file */
+  PageNumber numFreePages; /* bits set in freeMap */
+  PageNumber freeHint; /* no page below it is free */
+} SM_FileMgmtInfo;
+
+/* requests an io_uring keeps in flight */
+#define SM_IO_QUEUE_DEPTH 64
+
+/* default growth step of SM_GROW_PREALLOCATE, 4 MB */
+#define SM_EXTENT_PAGES 1024
+
+/* pages readNextBlock asks the kernel to read ahead of a sequential scan */
+#define SM_READ_AHEAD_PAGES 32
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
@@ -24,20 +75,46 @@ extern RC createPageFile (char *fileName);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
+extern RC createPageFileWithFreeMap (char *fileName, PageNumber maxPages);
 
 /* reading blocks from disc */
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
-extern int getBlockPos (SM_FileHandle *fHandle);
+extern RC readBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern PageNumber getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (PageNumber pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC readPages (const PageNumber *pageNums, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages, RC *results);
 
 /* writing blocks to a page file */
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (PageNumber pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC writePages (const PageNumber *pageNums, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages, RC *results);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
-extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC appendEmptyBlocks (SM_FileHandle *fHandle, int numPages);
+extern RC ensureCapacity (PageNumber numberOfPages, SM_FileHandle *fHandle);
+extern RC reserveCapacity (PageNumber numberOfPages, SM_FileHandle *fHandle);
+extern RC setFileGrowth (SM_FileHandle *fHandle, SM_GrowthMode mode, int extentPages);
+
+/* I/O backend */
+extern RC setIOBackend (SM_FileHandle *fHandle, SM_IOBackend backend);
+extern SM_IOBackend getIOBackend (SM_FileHandle *fHandle);
+extern RC registerIOBuffers (SM_FileHandle *fHandle, const struct iovec *buffers, int numBuffers);
+extern RC setDirectIO (SM_FileHandle *fHandle, int direct);
+
+/* memory-mapped reads */
+extern RC mapPageFile (SM_FileHandle *fHandle, SM_AccessPattern pattern);
+extern RC unmapPageFile (SM_FileHandle *fHandle);
+extern SM_PageHandle getMappedPage (SM_FileHandle *fHandle, PageNumber pageNum);
+
+/* free-space map */
+extern RC allocatePage (SM_FileHandle *fHandle, PageNumber *pageNum);
+extern RC freePage (SM_FileHandle *fHandle, PageNumber pageNum, int punchHole);
+extern PageNumber nextAllocatedPage (SM_FileHandle *fHandle, PageNumber pageNum);
+extern PageNumber getNumFreePages (SM_FileHandle *fHandle);
+extern int getNumHeaderPages (SM_FileHandle *fHandle);
 
 #endif
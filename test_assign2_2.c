@@ -0,0 +1,2024 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// var to store the current test's name
+char *testName;
+
+// check whether two the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+  do {									\
+    char *real;								\
+    char *_exp = (char *) (expected);                                   \
+    real = sprintPoolContent(bm);					\
+    if (strcmp((_exp),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+    free(real);								\
+  } while(0)
+
+// test and helper methods
+static void createDummyPages(BM_BufferPool *bm, int num);
+
+static void testCLOCK (void);
+static void testLRU_K (void);
+static void testLFU (void);
+static void testARC (void);
+static void test2Q (void);
+static void testAdmission (void);
+static void testFrameArena (void);
+static void testConcurrentPins (void);
+static void testConcurrentHits (void);
+static void testPartitions (void);
+static void testBackgroundFlush (void);
+static void testBatchedFlush (void);
+static void testReadAhead (void);
+static void testPrefetchPages (void);
+static void testPrefetchNoReference (void);
+static void testPinPages (void);
+static void testIOUring (void);
+static void testDirectIO (void);
+static void testReadOnlyPool (void);
+static void testLargePageFile (void);
+static void testFileGrowth (void);
+static void testPinNewPage (void);
+static void testFreePageMap (void);
+static void testPositionedIO (void);
+static void testInitFailure (void);
+static void testLRURelease (void);
+static void testLatchedHits (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testCLOCK();
+  testLRU_K();
+  testLFU();
+  testARC();
+  test2Q();
+  testAdmission();
+  testFrameArena();
+  testConcurrentPins();
+  testConcurrentHits();
+  testPartitions();
+  testBackgroundFlush();
+  testBatchedFlush();
+  testReadAhead();
+  testPrefetchPages();
+  testPrefetchNoReference();
+  testPinPages();
+  testIOUring();
+  testDirectIO();
+  testReadOnlyPool();
+  testLargePageFile();
+  testFileGrowth();
+  testPinNewPage();
+  testFreePageMap();
+  testPositionedIO();
+  testInitFailure();
+  testLRURelease();
+  testLatchedHits();
+}
+
+void
+createDummyPages(BM_BufferPool *bm, int num)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  for (i = 0; i < num; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%lld", "Page", h->pageNum);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm,h));
+    }
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(h);
+}
+
+// test the CLOCK page replacement strategy
+void
+testCLOCK (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    // read first three pages and directly unpin them
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    // every reference bit is set, the hand clears them all and takes frame 0
+    "[3 0],[1 0],[2 0]",
+    // a hit on page 1 gives it a second chance
+    "[3 0],[1 0],[2 0]",
+    "[3 0],[1 0],[4 0]",
+    "[3 0],[5 0],[4 0]",
+    // a pinned frame is never chosen
+    "[3 0],[5 0],[4 1]",
+    "[6 0],[5 0],[4 1]"
+  };
+  const int requests[] = {0,1,2,3,1,4,5};
+  const int numLinRequests = 7;
+
+  int i;
+  int snapshot = 0;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing CLOCK page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_CLOCK, NULL));
+
+  for(i = 0; i < numLinRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content");
+  }
+
+  pinPage(bm, h, 4);
+  ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "pin page 4 and keep it pinned");
+
+  pinPage(bm, h, 6);
+  unpinPage(bm, h);
+  ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "pinned frame is skipped");
+
+  h->pageNum = 4;
+  unpinPage(bm, h);
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the LRU-K page replacement strategy with k = 2
+void
+testLRU_K (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages 0 and 1 get a second reference
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages seen once have an infinite 2-distance, a scan only churns one frame
+    "[0 0],[1 0],[3 0]",
+    "[0 0],[1 0],[4 0]",
+    "[0 0],[1 0],[5 0]",
+    // once every page has two references the oldest second reference goes
+    "[0 0],[1 0],[5 0]",
+    "[6 0],[1 0],[5 0]"
+  };
+  const int requests[] = {0,1,2,0,1,3,4,5,5,6};
+  const int numRequests = 10;
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_LRUKParams params;
+  testName = "Testing LRU-K page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+
+  params.k = 2;
+  params.correlatedPeriod = 0;
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &params));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+  CHECK(shutdownBufferPool(bm));
+
+  // two quick pins of page 0 are one correlated reference, so page 0 is
+  // still seen once and, being older than page 1, goes first
+  params.correlatedPeriod = 3;
+  CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LRU_K, &params));
+  for(i = 0; i < 3; i++)
+  {
+      pinPage(bm, h, i / 2);
+      unpinPage(bm, h);
+  }
+  ASSERT_EQUALS_POOL("[0 0],[1 0]", bm, "check pool content");
+  pinPage(bm, h, 2);
+  unpinPage(bm, h);
+  ASSERT_EQUALS_POOL("[2 0],[1 0]", bm, "correlated pins count once");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the LFU page replacement strategy with and without aging
+void
+testLFU (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    // page 0 is pinned three times, page 1 twice
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages pinned once are evicted first
+    "[0 0],[1 0],[3 0]",
+    "[0 0],[1 0],[4 0]",
+    // page 4 reaches the frequency of page 1, which was counted earlier and goes
+    "[0 0],[1 0],[4 0]",
+    "[0 0],[5 0],[4 0]"
+  };
+  const int requests[] = {0,1,2,0,0,1,3,4,4,5};
+  const int numRequests = 10;
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_LFUParams params;
+  testName = "Testing LFU page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  // a pinned frame is never chosen, even with the lowest frequency
+  pinPage(bm, h, 5);
+  pinPage(bm, h, 4);
+  unpinPage(bm, h);
+  pinPage(bm, h, 6);
+  unpinPage(bm, h);
+  ASSERT_EQUALS_POOL("[6 0],[5 1],[4 0]", bm, "pinned frame is skipped");
+  h->pageNum = 5;
+  unpinPage(bm, h);
+
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+  CHECK(shutdownBufferPool(bm));
+
+  // page 0 was pinned 4 times and page 1 only 3 times, but halving every
+  // 4 pins leaves page 0 with 2 and page 1 with 3
+  params.agingPeriod = 4;
+  CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LFU, &params));
+  for(i = 0; i < 7; i++)
+  {
+      pinPage(bm, h, (i < 4) ? 0 : 1);
+      unpinPage(bm, h);
+  }
+  ASSERT_EQUALS_POOL("[0 0],[1 0]", bm, "check pool content");
+  pinPage(bm, h, 2);
+  unpinPage(bm, h);
+  ASSERT_EQUALS_POOL("[2 0],[1 0]", bm, "old popularity decays");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the ARC page replacement strategy
+void
+testARC (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    // page 0 moves to t2
+    "[0 0],[1 0],[2 0]",
+    // t1 is above its target, its LRU page 1 becomes a ghost in b1
+    "[0 0],[3 0],[2 0]",
+    // ghost hit in b1: t1 target grows, page 2 leaves t1, page 1 joins t2
+    "[0 0],[3 0],[1 0]",
+    // t1 is at its target, the LRU page of t2 becomes a ghost in b2
+    "[4 0],[3 0],[1 0]",
+    // ghost hit in b2: t1 target shrinks again, page 3 leaves t1
+    "[4 0],[0 0],[1 0]",
+    // page 4 was only seen once and goes before page 1, which LRU would evict
+    "[5 0],[0 0],[1 0]"
+  };
+  const int requests[] = {0,1,2,0,3,1,4,0,5};
+  const int numRequests = 9;
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing ARC page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_ARC, NULL));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+
+  // a miss that finds no free frame leaves the target and the ghosts as they were
+  {
+    BM_ARCData *arc = (BM_ARCData *)bm->strategyData;
+    BM_PageHandle pinned[3];
+    int target = arc->target, b1 = arc->b1.length, b2 = arc->b2.length;
+
+    CHECK(pinPage(bm, &pinned[0], 5));
+    CHECK(pinPage(bm, &pinned[1], 0));
+    CHECK(pinPage(bm, &pinned[2], 1));
+    for(i = 2; i <= 4; i++)
+      ASSERT_EQUALS_INT(RC_NO_FREE_FRAME, pinPage(bm, h, i), "miss without a free frame fails");
+    ASSERT_EQUALS_INT(target, arc->target, "failed miss keeps the target");
+    ASSERT_EQUALS_INT(b1, arc->b1.length, "failed miss keeps b1");
+    ASSERT_EQUALS_INT(b2, arc->b2.length, "failed miss keeps b2");
+    ASSERT_TRUE(!arc->missInB1 && !arc->missInB2 && !arc->dropFromT1, "failed miss clears the flags");
+    for(i = 0; i < 3; i++)
+      CHECK(unpinPage(bm, &pinned[i]));
+  }
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the 2Q page replacement strategy (kin = 1 frame, kout = 2 ghosts)
+void
+test2Q (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0],[-1 0]",
+    // a second pin while in a1in does not promote the page
+    "[0 0],[-1 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[3 0]",
+    // a1in is over kin, its oldest page goes to a1out
+    "[4 0],[1 0],[2 0],[3 0]",
+    // pages 0 and 1 come back from a1out and enter am
+    "[4 0],[0 0],[2 0],[3 0]",
+    "[4 0],[0 0],[1 0],[3 0]",
+    // a scan only cycles through a1in, am keeps pages 0 and 1
+    "[4 0],[0 0],[1 0],[5 0]",
+    "[6 0],[0 0],[1 0],[5 0]",
+    "[6 0],[0 0],[1 0],[7 0]",
+    "[6 0],[0 0],[1 0],[7 0]"
+  };
+  const int requests[] = {0,0,1,2,3,4,0,1,5,6,7,0};
+  const int numRequests = 12;
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing 2Q page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_2Q, NULL));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "check number of read I/Os");
+
+  // a miss that finds no free frame keeps the a1out ghost and clears missInA1out
+  {
+    BM_2QData *twoQ = (BM_2QData *)bm->strategyData;
+    BM_PageHandle pinned[4];
+    int a1out = twoQ->a1out.length;
+
+    CHECK(pinPage(bm, &pinned[0], 6));
+    CHECK(pinPage(bm, &pinned[1], 0));
+    CHECK(pinPage(bm, &pinned[2], 1));
+    CHECK(pinPage(bm, &pinned[3], 7));
+    for(i = 2; i <= 5; i++)
+      ASSERT_EQUALS_INT(RC_NO_FREE_FRAME, pinPage(bm, h, i), "miss without a free frame fails");
+    ASSERT_EQUALS_INT(a1out, twoQ->a1out.length, "failed miss keeps a1out");
+    ASSERT_TRUE(!twoQ->missInA1out, "failed miss clears missInA1out");
+    for(i = 0; i < 4; i++)
+      CHECK(unpinPage(bm, &pinned[i]));
+  }
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the TinyLFU admission filter in front of LRU
+void
+testAdmission (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0],[-1 0]",
+    "[0 0],[-1 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[-1 0]",
+    // a scan is not admitted and only cycles through the window frame
+    "[0 0],[1 0],[2 0],[10 0]",
+    "[0 0],[1 0],[2 0],[11 0]",
+    "[0 0],[1 0],[2 0],[12 0]",
+    "[0 0],[1 0],[2 0],[10 0]",
+    "[0 0],[1 0],[2 0],[10 0]",
+    "[0 0],[1 0],[2 0],[12 0]",
+    // page 10 is now hotter than the LRU victim and is admitted
+    "[10 0],[1 0],[2 0],[12 0]"
+  };
+  const int requests[] = {0,0,1,1,2,2,10,11,12,10,10,12,10};
+  const int numRequests = 13;
+  BM_PoolOptions options = { .admissionFilter = TRUE, .admissionWindowPercent = 25 };
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing TinyLFU admission filter";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(9, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test that the frames live in one page aligned arena
+void
+testFrameArena (void)
+{
+  BM_PoolOptions options = { .hugePages = TRUE };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *first;
+  char expected[16];
+  int i;
+  testName = "Testing contiguous frame arena";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+
+  CHECK(pinPage(bm, h, 0));
+  first = h->data;
+  ASSERT_TRUE(((unsigned long) first) % PAGE_SIZE == 0, "frame data is page aligned");
+  CHECK(unpinPage(bm, h));
+  for(i = 1; i < 3; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      ASSERT_TRUE(h->data == first + i * PAGE_SIZE, "frames are contiguous");
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page content was read into the arena");
+      CHECK(unpinPage(bm, h));
+  }
+
+  // an evicted frame is reused in place
+  CHECK(pinPage(bm, h, 7));
+  ASSERT_TRUE(h->data == first, "FIFO victim frame 0 is reused");
+  CHECK(unpinPage(bm, h));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// shared by the threads of testConcurrentPins
+#define CONCURRENT_THREADS 4
+#define CONCURRENT_ROUNDS 2000
+#define COUNTER_OFFSET 100
+
+typedef struct ConcurrentArgs {
+  BM_BufferPool *bm;
+  pthread_barrier_t *start;
+  unsigned int seed;
+  int failures;
+} ConcurrentArgs;
+
+// pin the same missing page from every thread at once
+static void *
+pinSamePage (void *arg)
+{
+  ConcurrentArgs *args = (ConcurrentArgs *) arg;
+  BM_PageHandle h;
+
+  pthread_barrier_wait(args->start);
+  if (pinPage(args->bm, &h, 3) != RC_OK || strcmp(h.data, "Page-3") != 0)
+    args->failures++;
+  unpinPage(args->bm, &h);
+  return NULL;
+}
+
+// read random pages and count in page 0 under its exclusive latch
+static void *
+pinRandomPages (void *arg)
+{
+  ConcurrentArgs *args = (ConcurrentArgs *) arg;
+  BM_PageHandle h;
+  char expected[16];
+  int i, pageNum;
+
+  pthread_barrier_wait(args->start);
+  for(i = 0; i < CONCURRENT_ROUNDS; i++)
+  {
+      pageNum = rand_r(&(args->seed)) % 30;
+      if (pinPage(args->bm, &h, pageNum) != RC_OK)
+      {
+          args->failures++;
+          continue;
+      }
+      if (pageNum == 0)
+      {
+          latchPage(args->bm, &h, TRUE);
+          (*(int *) (h.data + COUNTER_OFFSET))++;
+          markDirty(args->bm, &h);
+          unlatchPage(args->bm, &h);
+      }
+      else
+      {
+          latchPage(args->bm, &h, FALSE);
+          sprintf(expected, "%s-%i", "Page", pageNum);
+          if (strcmp(h.data, expected) != 0)
+            args->failures++;
+          unlatchPage(args->bm, &h);
+      }
+      unpinPage(args->bm, &h);
+  }
+  return NULL;
+}
+
+// test that threads can share a pool
+void
+testConcurrentPins (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  pthread_t threads[CONCURRENT_THREADS];
+  ConcurrentArgs args[CONCURRENT_THREADS];
+  pthread_barrier_t start;
+  int i, failures, zeroPins;
+  testName = "Testing concurrent pins";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 30);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 6, RS_LRU, NULL));
+
+  // concurrent misses of one page share a single read
+  pthread_barrier_init(&start, NULL, CONCURRENT_THREADS);
+  for(i = 0; i < CONCURRENT_THREADS; i++)
+  {
+      args[i].bm = bm;
+      args[i].start = &start;
+      args[i].seed = i + 1;
+      args[i].failures = 0;
+      pthread_create(&threads[i], NULL, pinSamePage, &args[i]);
+  }
+  failures = 0;
+  for(i = 0; i < CONCURRENT_THREADS; i++)
+  {
+      pthread_join(threads[i], NULL);
+      failures += args[i].failures;
+  }
+  ASSERT_EQUALS_INT(0, failures, "every thread sees page 3");
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "page 3 is read once");
+
+  CHECK(pinPage(bm, h, 0));
+  *(int *) (h->data + COUNTER_OFFSET) = 0;
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+
+  // random pins with evictions, page 0 is written back and read again
+  for(i = 0; i < CONCURRENT_THREADS; i++)
+    pthread_create(&threads[i], NULL, pinRandomPages, &args[i]);
+  for(i = 0; i < CONCURRENT_THREADS; i++)
+  {
+      pthread_join(threads[i], NULL);
+      failures += args[i].failures;
+  }
+  pthread_barrier_destroy(&start);
+  ASSERT_EQUALS_INT(0, failures, "every pin sees its own page");
+
+  zeroPins = 0;
+  CHECK(pinPage(bm, h, 0));
+  zeroPins = *(int *) (h->data + COUNTER_OFFSET);
+  CHECK(unpinPage(bm, h));
+  for(i = 0; i < CONCURRENT_THREADS; i++)
+  {
+      unsigned int seed = i + 1;
+      int round;
+      for(round = 0; round < CONCURRENT_ROUNDS; round++)
+        if (rand_r(&seed) % 30 == 0)
+          zeroPins--;
+  }
+  ASSERT_EQUALS_INT(0, zeroPins, "no update of page 0 is lost");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pin and unpin resident pages only, two pins at a time
+static void *
+pinResidentPages (void *arg)
+{
+  ConcurrentArgs *args = (ConcurrentArgs *) arg;
+  BM_PageHandle h, g;
+  char expected[16];
+  int i, pageNum;
+
+  pthread_barrier_wait(args->start);
+  for(i = 0; i < CONCURRENT_ROUNDS; i++)
+  {
+      pageNum = rand_r(&(args->seed)) % 4;
+      if (pinPage(args->bm, &h, pageNum) != RC_OK || pinPage(args->bm, &g, (pageNum + 1) % 4) != RC_OK)
+      {
+          args->failures++;
+          continue;
+      }
+      sprintf(expected, "%s-%i", "Page", pageNum);
+      if (strcmp(h.data, expected) != 0)
+        args->failures++;
+      unpinPage(args->bm, &g);
+      unpinPage(args->bm, &h);
+  }
+  return NULL;
+}
+
+// test that concurrent hits keep exact fix counts without any I/O
+void
+testConcurrentHits (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  pthread_t threads[CONCURRENT_THREADS];
+  ConcurrentArgs args[CONCURRENT_THREADS];
+  pthread_barrier_t start;
+  ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+  int i, s, failures;
+  testName = "Testing concurrent hits";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 4);
+  for(s = 0; s < 7; s++)
+  {
+      CHECK(initBufferPool(bm, "testbuffer.bin", 4, strategies[s], NULL));
+      for(i = 0; i < 4; i++)
+      {
+          CHECK(pinPage(bm, h, i));
+          CHECK(unpinPage(bm, h));
+      }
+
+      pthread_barrier_init(&start, NULL, CONCURRENT_THREADS);
+      for(i = 0; i < CONCURRENT_THREADS; i++)
+      {
+          args[i].bm = bm;
+          args[i].start = &start;
+          args[i].seed = i + 1;
+          args[i].failures = 0;
+          pthread_create(&threads[i], NULL, pinResidentPages, &args[i]);
+      }
+      failures = 0;
+      for(i = 0; i < CONCURRENT_THREADS; i++)
+      {
+          pthread_join(threads[i], NULL);
+          failures += args[i].failures;
+      }
+      pthread_barrier_destroy(&start);
+      ASSERT_EQUALS_INT(0, failures, "every hit sees its own page");
+      ASSERT_EQUALS_INT(4, getNumReadIO(bm), "hits do not read");
+      ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0]", bm, "every pin was released");
+      CHECK(shutdownBufferPool(bm));
+  }
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test that a partitioned pool keeps every partition to its own frames
+void
+testPartitions (void)
+{
+  BM_PoolOptions options = { .partitions = 3 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *g = MAKE_PAGE_HANDLE();
+  int i;
+  // pages 0, 3, 4 and 7 hash to partition 0 (frames 0-1), 2 and 6 to
+  // partition 1 (frames 2-3), 1 and 5 to partition 2 (frames 4-5)
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0]",
+    "[0 0],[-1 0],[-1 0],[-1 0],[1 0],[-1 0]",
+    "[0 0],[-1 0],[2 0],[-1 0],[1 0],[-1 0]",
+    "[0 0],[3 0],[2 0],[-1 0],[1 0],[-1 0]",
+    // partition 0 is full, FIFO evicts its page 0 although other frames are empty
+    "[4 0],[3 0],[2 0],[-1 0],[1 0],[-1 0]"
+  };
+  testName = "Testing partitioned pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 6, RS_FIFO, NULL, &options));
+
+  for(i = 0; i < 5; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  // every frame of partition 0 pinned, page 7 cannot be loaded
+  CHECK(pinPage(bm, h, 3));
+  CHECK(pinPage(bm, g, 4));
+  ASSERT_TRUE(pinPage(bm, h, 7) == RC_NO_FREE_FRAME, "partition 0 has no free frame");
+  CHECK(unpinPage(bm, g));
+  CHECK(unpinPage(bm, h));
+
+  // a page of another partition is marked dirty and flushed through the shared file
+  CHECK(pinPage(bm, h, 6));
+  CHECK(markDirty(bm, h));
+  ASSERT_EQUALS_POOL("[4 0],[3 0],[2 0],[6x1],[1 0],[-1 0]", bm, "page 6 is dirty in partition 1");
+  CHECK(unpinPage(bm, h));
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(6, getNumReadIO(bm), "reads of every partition are counted");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "page 6 was written");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  free(g);
+  TEST_DONE();
+}
+
+// test that the background flusher cleans a page before it is evicted
+void
+testBackgroundFlush (void)
+{
+  BM_PoolOptions options = { .backgroundFlush = TRUE, .cleanPercent = 100, .flushIntervalMs = 60000 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  bool *dirty;
+  int i;
+  testName = "Testing background flusher";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+
+  // a pool without a flusher has nothing to wake
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  ASSERT_EQUALS_INT(RC_NO_FLUSHER, wakeFlusher(bm), "no flusher to wake");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+  // let the first pass of the new thread finish, the next one only runs when woken
+  CHECK(wakeFlusher(bm));
+
+  CHECK(pinPage(bm, h, 0));
+  sprintf(h->data, "%s", "Flushed-0");
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "the flusher sleeps until it is woken");
+
+  CHECK(wakeFlusher(bm));
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "the woken flusher wrote page 0");
+  dirty = getDirtyFlags(bm);
+  ASSERT_TRUE(!dirty[0], "page 0 is clean again");
+  free(dirty);
+
+  // page 0 is evicted without a write on the miss path
+  for(i = 1; i < 4; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+  }
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "FIFO evicted page 0");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "the miss did not write");
+
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("Flushed-0", h->data, "the flushed content was read back");
+
+  // a shutdown that fails on the pinned page leaves both background threads running
+  {
+    const PageNumber wanted[] = {5};
+
+    CHECK(prefetchPages(bm, wanted, 1));
+    ASSERT_EQUALS_INT(RC_SHUTDOWN_POOL_FAILED, shutdownBufferPool(bm), "pinned page stops the shutdown");
+    ASSERT_TRUE(bm->flusher != NULL, "the flusher runs again");
+    ASSERT_TRUE(bm->prefetcher != NULL, "the prefetcher runs again");
+  }
+  CHECK(unpinPage(bm, h));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test that forceFlushPool writes every dirty page to its own place in runs
+void
+testBatchedFlush (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char expected[16];
+  bool *dirty;
+  int i;
+  // runs 0-1 and 3-5 after sorting, page 9 alone, page 4 stays clean
+  const int pages[] = {5, 3, 4, 9, 0, 1};
+  testName = "Testing batched forceFlushPool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 6, RS_FIFO, NULL));
+
+  for(i = 0; i < 6; i++)
+  {
+      CHECK(pinPage(bm, h, pages[i]));
+      if (pages[i] != 4)
+      {
+          sprintf(h->data, "%s-%i", "Batch", pages[i]);
+          CHECK(markDirty(bm, h));
+      }
+      CHECK(unpinPage(bm, h));
+  }
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(5, getNumWriteIO(bm), "every dirty page is written once");
+  dirty = getDirtyFlags(bm);
+  for(i = 0; i < 6; i++)
+    ASSERT_TRUE(!dirty[i], "no page is dirty after the flush");
+  free(dirty);
+  CHECK(shutdownBufferPool(bm));
+
+  // a new pool reads what the flush wrote
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for(i = 0; i < 10; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      if (i == 2 || i == 4 || (i > 5 && i != 9))
+        sprintf(expected, "%s-%i", "Page", i);
+      else
+        sprintf(expected, "%s-%i", "Batch", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page holds its own content");
+      CHECK(unpinPage(bm, h));
+  }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test sequential read-ahead
+void
+testReadAhead (void)
+{
+  BM_PoolOptions options = { .readAheadPages = 4 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char expected[16];
+  int i;
+  testName = "Testing sequential read-ahead";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_FIFO, NULL, &options));
+
+  // only page 0 is a demand read, every later page was read ahead of its pin
+  for(i = 0; i < 20; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "read ahead page holds its own content");
+      CHECK(unpinPage(bm, h));
+  }
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "one demand read");
+  ASSERT_EQUALS_INT(19, getNumPrefetchIO(bm), "pages 1 to 19 were read ahead");
+  ASSERT_EQUALS_INT(19, getNumPrefetchHits(bm), "every read ahead page was pinned");
+
+  // pinning page 19 again is a plain hit, nothing past the file end is read
+  CHECK(pinPage(bm, h, 19));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(19, getNumPrefetchHits(bm), "a second pin is no prefetch hit");
+  ASSERT_EQUALS_INT(20, (int)bm->fileHandle.totalNumPages, "read-ahead does not grow the file");
+  CHECK(shutdownBufferPool(bm));
+
+  // without the option nothing is read ahead
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_FIFO, NULL));
+  for(i = 0; i < 20; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+  }
+  ASSERT_EQUALS_INT(20, getNumReadIO(bm), "every page is a demand read");
+  ASSERT_EQUALS_INT(0, getNumPrefetchIO(bm), "no read-ahead");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // two interleaved scans and a page pinned now and then each keep their own read-ahead
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 60);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 64, RS_FIFO, NULL, &options));
+  for(i = 0; i < 20; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "the first scan sees its own page");
+      CHECK(unpinPage(bm, h));
+      CHECK(pinPage(bm, h, 40 + i));
+      sprintf(expected, "%s-%i", "Page", 40 + i);
+      ASSERT_EQUALS_STRING(expected, h->data, "the second scan sees its own page");
+      CHECK(unpinPage(bm, h));
+      if (i % 5 == 4)
+      {
+          CHECK(pinPage(bm, h, 30));
+          CHECK(unpinPage(bm, h));
+      }
+  }
+  ASSERT_EQUALS_INT(4, getNumReadIO(bm), "only pages 0, 40, 41 and 30 are demand reads");
+  ASSERT_EQUALS_INT(37, getNumPrefetchHits(bm), "both scans were read ahead");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test asynchronous prefetching of given pages
+void
+testPrefetchPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char expected[16];
+  int i;
+  // 3 twice, 40 is past the end of the file
+  const PageNumber wanted[] = {12, 3, 7, 4, 5, 3, 40};
+  const PageNumber pinned[] = {3, 4, 5, 7, 12};
+  testName = "Testing prefetchPages";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_FIFO, NULL));
+
+  CHECK(prefetchPages(bm, wanted, 7));
+  // a pin either finds the page read or waits for its read
+  for(i = 0; i < 5; i++)
+  {
+      CHECK(pinPage(bm, h, pinned[i]));
+      sprintf(expected, "%s-%lld", "Page", pinned[i]);
+      ASSERT_EQUALS_STRING(expected, h->data, "prefetched page holds its own content");
+      CHECK(unpinPage(bm, h));
+  }
+  ASSERT_EQUALS_INT(0, getNumReadIO(bm), "no demand read");
+  ASSERT_EQUALS_INT(5, getNumPrefetchIO(bm), "every page was prefetched once");
+  ASSERT_EQUALS_INT(5, getNumPrefetchHits(bm), "every pin was a prefetch hit");
+  ASSERT_EQUALS_INT(20, (int)bm->fileHandle.totalNumPages, "prefetching does not grow the file");
+
+  // resident pages are not read again
+  CHECK(prefetchPages(bm, pinned, 5));
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_EQUALS_INT(5, getNumPrefetchIO(bm), "resident pages are skipped");
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test batched pins
+void
+testPinPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle handles[5];
+  char expected[16];
+  int *fixCounts;
+  int i;
+  // 3 is a hit, 8 is asked for twice
+  const PageNumber pages[] = {9, 8, 3, 10, 8};
+  const PageNumber tooMany[] = {11, 12, 13, 14, 15};
+  testName = "Testing pinPages";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_FIFO, NULL));
+  for(i = 0; i < 4; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Dirty", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+  }
+
+  // victims 0 to 2 are written as one run, misses 8 to 10 are read as one run
+  CHECK(pinPages(bm, handles, pages, 5));
+  ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "every dirty victim is written once");
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "every miss is read once");
+  for(i = 0; i < 5; i++)
+  {
+      if (pages[i] == 3)
+        sprintf(expected, "%s-%lld", "Dirty", pages[i]);
+      else
+        sprintf(expected, "%s-%lld", "Page", pages[i]);
+      ASSERT_EQUALS_STRING(expected, handles[i].data, "each handle holds its own page");
+      ASSERT_EQUALS_INT((int)pages[i], (int)handles[i].pageNum, "each handle has its page number");
+  }
+  ASSERT_TRUE(handles[1].data == handles[4].data, "a page asked for twice shares its frame");
+  fixCounts = getFixCounts(bm);
+  ASSERT_EQUALS_INT(5, fixCounts[0] + fixCounts[1] + fixCounts[2] + fixCounts[3], "one pin per requested page");
+  free(fixCounts);
+  for(i = 0; i < 5; i++)
+    CHECK(unpinPage(bm, handles + i));
+
+  // more pages than frames pins none of them
+  ASSERT_TRUE(pinPages(bm, handles, tooMany, 5) == RC_NO_FREE_FRAME, "five misses do not fit four frames");
+  fixCounts = getFixCounts(bm);
+  for(i = 0; i < 4; i++)
+    ASSERT_EQUALS_INT(0, fixCounts[i], "a failed pinPages leaves no pin");
+  free(fixCounts);
+  CHECK(shutdownBufferPool(bm));
+
+  // the victims reached the file
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_FIFO, NULL));
+  for(i = 0; i < 4; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Dirty", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "written victim holds its new content");
+      CHECK(unpinPage(bm, h));
+  }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the io_uring backend, or the synchronous fallback where the kernel has none
+void
+testIOUring (void)
+{
+  BM_PoolOptions options = { .ioBackend = SM_IO_URING };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle handles[10];
+  SM_FileHandle fh;
+  SM_PageHandle pages[100];
+  char expected[16];
+  PageNumber pageNums[10];
+  RC rc;
+  int i;
+  testName = "Testing io_uring backend";
+
+  // more pages than the ring holds at once
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  rc = setIOBackend(&fh, SM_IO_URING);
+  ASSERT_TRUE(rc == RC_OK || rc == RC_IO_BACKEND_NOT_AVAILABLE, "io_uring is set up or not offered");
+  ASSERT_TRUE(getIOBackend(&fh) == (rc == RC_OK ? SM_IO_URING : SM_IO_SYNC), "the backend in use is reported");
+  if (rc != RC_OK)
+    printf("[%s-%s-L%i-%s] SKIPPED: the kernel offers no io_uring, only the synchronous fallback is tested\n", TEST_INFO);
+  for(i = 0; i < 100; i++)
+  {
+      pages[i] = (SM_PageHandle) calloc(PAGE_SIZE, 1);
+      sprintf(pages[i], "%s-%i", "Ring", i);
+  }
+  CHECK(writeBlocks(0, 100, &fh, pages));
+  ASSERT_EQUALS_INT(100, (int)fh.totalNumPages, "the file grew by the pages written");
+  for(i = 0; i < 100; i++)
+    memset(pages[i], 0, PAGE_SIZE);
+  CHECK(readBlocks(0, 100, &fh, pages));
+  for(i = 0; i < 100; i++)
+  {
+      sprintf(expected, "%s-%i", "Ring", i);
+      ASSERT_EQUALS_STRING(expected, pages[i], "each page reads back what was written");
+  }
+  if (rc == RC_OK)
+    ASSERT_TRUE(((SM_FileMgmtInfo *) fh.mgmtInfo)->ringPages == 200, "every page went through the ring");
+
+  // scattered pages go out as one batch, each with its own result
+  {
+    PageNumber scattered[30];
+    RC results[30];
+
+    for(i = 0; i < 30; i++)
+    {
+        scattered[i] = 31 + 2 * i;
+        sprintf(pages[i], "%s-%i", "Scatter", 31 + 2 * i);
+    }
+    CHECK(writePages(scattered, 30, &fh, pages, results));
+    for(i = 0; i < 30; i++)
+    {
+        ASSERT_TRUE(results[i] == RC_OK, "each scattered page was written");
+        memset(pages[i], 0, PAGE_SIZE);
+    }
+    CHECK(readPages(scattered, 30, &fh, pages, results));
+    for(i = 0; i < 30; i++)
+    {
+        sprintf(expected, "%s-%i", "Scatter", 31 + 2 * i);
+        ASSERT_EQUALS_STRING(expected, pages[i], "each scattered page reads back");
+        ASSERT_TRUE(results[i] == RC_OK, "each scattered page was read");
+    }
+    if (rc == RC_OK)
+      ASSERT_TRUE(((SM_FileMgmtInfo *) fh.mgmtInfo)->ringPages == 260, "the scattered pages went through the ring");
+    scattered[29] = 100;
+    ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, readPages(scattered, 30, &fh, pages, results), "a page past the end refuses the batch");
+    ASSERT_TRUE(results[0] == RC_READ_NON_EXISTING_PAGE, "every page of a refused batch reports it");
+  }
+  for(i = 0; i < 100; i++)
+    free(pages[i]);
+  CHECK(setIOBackend(&fh, SM_IO_SYNC));
+  ASSERT_TRUE(getIOBackend(&fh) == SM_IO_SYNC, "the file is back on synchronous I/O");
+  CHECK(closePageFile(&fh));
+
+  // a pool reads and writes runs through the registered frames
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_FIFO, NULL, &options));
+  for(i = 0; i < 10; i++)
+    pageNums[i] = 20 + i;
+  CHECK(pinPages(bm, handles, pageNums, 10));
+  if (rc == RC_OK)
+    ASSERT_TRUE(((SM_FileMgmtInfo *) bm->fileHandle.mgmtInfo)->ringPages == 10, "the pool read its pages through the ring");
+  for(i = 0; i < 10; i++)
+  {
+      sprintf(expected, "%s-%i", "Ring", 20 + i);
+      ASSERT_EQUALS_STRING(expected, handles[i].data, "pinned page holds its own content");
+      sprintf(handles[i].data, "%s-%i", "Fixed", 20 + i);
+      CHECK(markDirty(bm, handles + i));
+      CHECK(unpinPage(bm, handles + i));
+  }
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(10, getNumWriteIO(bm), "every dirty page is written once");
+  if (rc == RC_OK)
+    ASSERT_TRUE(((SM_FileMgmtInfo *) bm->fileHandle.mgmtInfo)->ringPages == 20, "the pool wrote its pages through the ring");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_FIFO, NULL));
+  CHECK(pinPages(bm, handles, pageNums, 10));
+  for(i = 0; i < 10; i++)
+  {
+      sprintf(expected, "%s-%i", "Fixed", 20 + i);
+      ASSERT_EQUALS_STRING(expected, handles[i].data, "the flush reached the file");
+      CHECK(unpinPage(bm, handles + i));
+  }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// test a page file opened for direct I/O, or its buffered fallback
+void
+testDirectIO (void)
+{
+  BM_PoolOptions options = { .directIO = TRUE };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *page = (char *) malloc(PAGE_SIZE + 1);
+  char expected[16];
+  RC rc;
+  int i;
+  testName = "Testing direct I/O";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+
+  // a buffer off the page boundary goes through a bounce page
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  rc = setDirectIO(&fh, TRUE);
+  ASSERT_TRUE(rc == RC_OK || rc == RC_DIRECT_IO_NOT_AVAILABLE, "direct I/O is set or not supported");
+  ASSERT_TRUE(((SM_FileMgmtInfo *) fh.mgmtInfo)->direct == (rc == RC_OK), "the file is in direct mode only if it was set");
+  if (rc != RC_OK)
+    printf("[%s-%s-L%i-%s] SKIPPED: the file system has no O_DIRECT, only the buffered fallback is tested\n", TEST_INFO);
+  sprintf(page + 1, "%s", "Unaligned-3");
+  CHECK(writeBlock(3, &fh, page + 1));
+  memset(page, 0, PAGE_SIZE + 1);
+  CHECK(readBlock(3, &fh, page + 1));
+  ASSERT_EQUALS_STRING("Unaligned-3", page + 1, "an unaligned page round-trips");
+  CHECK(ensureCapacity(12, &fh));
+  CHECK(readBlock(11, &fh, page + 1));
+  ASSERT_EQUALS_INT(0, page[1], "a page added by ensureCapacity is empty");
+  CHECK(closePageFile(&fh));
+
+  // the pool reads and writes its aligned frames directly
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+  ASSERT_TRUE(((SM_FileMgmtInfo *) bm->fileHandle.mgmtInfo)->direct == (rc == RC_OK), "the pool opened its file in direct mode");
+  for(i = 0; i < 12; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      if (i == 3)
+        sprintf(expected, "%s", "Unaligned-3");
+      else if (i < 10)
+        sprintf(expected, "%s-%i", "Page", i);
+      else
+        expected[0] = '\0';
+      ASSERT_EQUALS_STRING(expected, h->data, "page holds its own content");
+      sprintf(h->data, "%s-%i", "Direct", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+  }
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for(i = 0; i < 12; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Direct", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "a direct write reached the file");
+      CHECK(unpinPage(bm, h));
+  }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test a read-only pool that pins pages in place in a mapping of the file
+void
+testReadOnlyPool (void)
+{
+  BM_PoolOptions options = { .readOnly = TRUE, .accessPattern = SM_ACCESS_SEQUENTIAL };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_PageHandle page = (SM_PageHandle) malloc(PAGE_SIZE);
+  char expected[16];
+  const PageNumber wanted[] = {7, 8};
+  int i;
+  testName = "Testing read-only mapped pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+
+  // storage reads copy from the mapping
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(mapPageFile(&fh, SM_ACCESS_RANDOM));
+  ASSERT_TRUE(getMappedPage(&fh, 9) != NULL, "the last page is mapped");
+  ASSERT_TRUE(getMappedPage(&fh, 10) == NULL, "a page past the file is not");
+  CHECK(readBlock(4, &fh, page));
+  ASSERT_EQUALS_STRING("Page-4", page, "readBlock copies from the mapping");
+  CHECK(readNextBlock(&fh, page));
+  ASSERT_EQUALS_STRING("Page-5", page, "readNextBlock copies from the mapping");
+  CHECK(unmapPageFile(&fh));
+  CHECK(closePageFile(&fh));
+
+  // a page cut short by the end of the file is not mapped, it is read with pread
+  ASSERT_TRUE(truncate("testbuffer.bin", 9 * PAGE_SIZE + PAGE_SIZE / 2) == 0, "the last page is cut in half");
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(mapPageFile(&fh, SM_ACCESS_RANDOM));
+  ASSERT_TRUE(getMappedPage(&fh, 8) != NULL, "the last whole page is mapped");
+  ASSERT_TRUE(getMappedPage(&fh, 9) == NULL, "the partial page is not");
+  CHECK(unmapPageFile(&fh));
+  CHECK(closePageFile(&fh));
+  ASSERT_TRUE(truncate("testbuffer.bin", 10 * PAGE_SIZE) == 0, "the file has whole pages again");
+
+  // the pool hands out pointers into its mapping, every frame holds no copy
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_LRU, NULL, &options));
+  CHECK(prefetchPages(bm, wanted, 2));
+  for(i = 0; i < 10; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page is read in place");
+      ASSERT_TRUE(h->data == getMappedPage(&(bm->fileHandle), i), "the handle points into the mapping");
+      ASSERT_TRUE(markDirty(bm, h) == RC_POOL_READ_ONLY, "a read-only page cannot be dirtied");
+      CHECK(unpinPage(bm, h));
+  }
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "every page was taken from the mapping once");
+  ASSERT_TRUE(pinPage(bm, h, 10) == RC_READ_NON_EXISTING_PAGE, "a read-only pool does not grow the file");
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "nothing was written");
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// the page that starts right at byte 2^31 of the file is read and written in place
+void
+testLargePageFile (void)
+{
+  const PageNumber far = (1LL << 31) / PAGE_SIZE;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *page = (char *) malloc(PAGE_SIZE);
+  char expected[32];
+  RC rc;
+  testName = "Testing pages past 2 GB";
+
+  CHECK(createPageFile("testbuffer.bin"));
+
+  // the file is sparse, only the page written takes space
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  rc = ensureCapacity(far + 1, &fh);
+  if (rc == RC_OK)
+  {
+      memset(page, 0, PAGE_SIZE);
+      sprintf(page, "%s-%lld", "Page", far);
+      rc = writeBlock(far, &fh, page);
+  }
+  if (rc != RC_OK)
+  {
+      printf("[%s-%s-L%i-%s] SKIPPED: the file system cannot hold a file of 2 GB\n", TEST_INFO);
+      closePageFile(&fh);
+      CHECK(destroyPageFile("testbuffer.bin"));
+      free(page);
+      free(bm);
+      free(h);
+      TEST_DONE();
+      return;
+  }
+  ASSERT_TRUE(fh.totalNumPages == far + 1, "the file ends with the page past 2 GB");
+  ASSERT_TRUE(getBlockPos(&fh) == far, "the position is the page written");
+  memset(page, 'x', PAGE_SIZE);
+  CHECK(readBlock(far, &fh, page));
+  ASSERT_EQUALS_STRING("Page-524288", page, "the page past 2 GB reads back");
+  CHECK(readBlock(far - 1, &fh, page));
+  ASSERT_EQUALS_INT(0, page[0], "the page before it is still a hole");
+  CHECK(closePageFile(&fh));
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_TRUE(fh.totalNumPages == far + 1, "the page count survives reopening");
+  CHECK(closePageFile(&fh));
+
+  // the pool maps and writes back the far page like any other
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, far));
+  ASSERT_TRUE(h->pageNum == far, "the handle has the 64-bit page number");
+  ASSERT_EQUALS_STRING("Page-524288", h->data, "the pool reads the far page");
+  sprintf(h->data, "%s-%lld", "Dirty", far);
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "the far page is written back");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(far, &fh, page));
+  sprintf(expected, "%s-%lld", "Dirty", far);
+  ASSERT_EQUALS_STRING(expected, page, "the far page was written at its own offset");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// files grow by ftruncate, sparse or with whole extents preallocated
+void
+testFileGrowth (void)
+{
+  BM_PoolOptions options = { .fileGrowth = SM_GROW_PREALLOCATE, .growthExtentPages = 32 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  struct stat st;
+  char *page = (char *) malloc(PAGE_SIZE);
+  RC rc;
+  testName = "Testing file growth";
+
+  // a sparse gigabyte takes no blocks and no memory
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(ensureCapacity(1 << 18, &fh));
+  ASSERT_EQUALS_INT(1 << 18, (int)fh.totalNumPages, "the file has the pages asked for");
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && st.st_size == (off_t)(1 << 18) * PAGE_SIZE, "the size is set");
+  ASSERT_TRUE((long long)st.st_blocks * 512 < (1 << 20), "the new pages are holes");
+  memset(page, 1, PAGE_SIZE);
+  CHECK(readBlock((1 << 18) - 1, &fh, page));
+  ASSERT_EQUALS_INT(0, page[0], "a new page reads as zeros");
+  CHECK(appendEmptyBlocks(&fh, 3));
+  CHECK(appendEmptyBlock(&fh));
+  ASSERT_EQUALS_INT((1 << 18) + 4, (int)fh.totalNumPages, "appended pages are counted");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // preallocated blocks past the end do not count as pages
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  rc = setFileGrowth(&fh, SM_GROW_PREALLOCATE, 16);
+  ASSERT_TRUE(rc == RC_OK || rc == RC_PREALLOCATE_NOT_AVAILABLE, "preallocation is set or not supported");
+  CHECK(ensureCapacity(5, &fh));
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && st.st_size == 5 * PAGE_SIZE, "the size ends at the last page");
+  if (rc == RC_OK)
+    ASSERT_TRUE((long long)st.st_blocks * 512 >= 16 * PAGE_SIZE, "a whole extent is reserved");
+  CHECK(closePageFile(&fh));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(5, (int)fh.totalNumPages, "reopening sees only the pages");
+  CHECK(closePageFile(&fh));
+
+  // a pin past the end grows the file of a pool the same way
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+  CHECK(pinPage(bm, h, 40));
+  ASSERT_EQUALS_INT(0, h->data[0], "the new page is empty");
+  sprintf(h->data, "%s", "Page-40");
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && st.st_size == 41 * PAGE_SIZE, "the pool grew the file to the pinned page");
+  if (rc == RC_OK)
+    ASSERT_TRUE((long long)st.st_blocks * 512 >= 64 * PAGE_SIZE, "the pool preallocates by its extent");
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(40, &fh, page));
+  ASSERT_EQUALS_STRING("Page-40", page, "the page was written into the grown file");
+  CHECK(closePageFile(&fh));
+
+  // pinNewPage reserves the next extent once its page count passes the reserved blocks
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+  rc = setFileGrowth(&(bm->fileHandle), SM_GROW_PREALLOCATE, 32);
+  ASSERT_TRUE(rc == RC_OK || rc == RC_PREALLOCATE_NOT_AVAILABLE, "preallocation is set or not supported");
+  do {
+    CHECK(pinNewPage(bm, h));
+    if (h->pageNum < 64)
+      CHECK(unpinPage(bm, h));
+  } while (h->pageNum < 64);
+  if (rc == RC_OK)
+  {
+    ASSERT_TRUE(((SM_FileMgmtInfo *)bm->fileHandle.mgmtInfo)->allocatedEnd == 96, "the extent after page 64 is reserved");
+    ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && (long long)st.st_blocks * 512 >= 96 * PAGE_SIZE, "the blocks are reserved before the page is written");
+  }
+  else
+    printf("[%s-%s-L%i-%s] SKIPPED: the file system cannot preallocate\n", TEST_INFO);
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && st.st_size == 65 * PAGE_SIZE, "the size still ends at the last page");
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// new pages are handed out zeroed and dirty, and written only on eviction
+void
+testPinNewPage (void)
+{
+  BM_PoolOptions options = { .readOnly = TRUE };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  struct stat st;
+  char *page = (char *) malloc(PAGE_SIZE);
+  char expected[16];
+  int i;
+  testName = "Testing pinNewPage";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 5);
+
+  // six new pages pass through three frames without a single read
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for(i = 0; i < 6; i++)
+  {
+      CHECK(pinNewPage(bm, h));
+      ASSERT_TRUE(h->pageNum == 5 + i, "new pages are numbered from the end of the file");
+      ASSERT_TRUE(h->dirty, "a new page is dirty");
+      ASSERT_EQUALS_INT(0, h->data[0], "a new page is empty");
+      sprintf(h->data, "%s-%i", "New", 5 + i);
+      CHECK(unpinPage(bm, h));
+  }
+  ASSERT_EQUALS_INT(0, getNumReadIO(bm), "new pages are not read");
+  ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "evicted new pages are written");
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && st.st_size == 8 * PAGE_SIZE, "the file grows only by written pages");
+  ASSERT_TRUE(bm->fileHandle.totalNumPages == 11, "the pool counts the new pages");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(11, (int)fh.totalNumPages, "every new page reached the file");
+  for(i = 0; i < 11; i++)
+  {
+      CHECK(readBlock(i, &fh, page));
+      if (i < 5)
+        sprintf(expected, "%s-%i", "Page", i);
+      else
+        sprintf(expected, "%s-%i", "New", i);
+      ASSERT_EQUALS_STRING(expected, page, "page holds its own content");
+  }
+  CHECK(closePageFile(&fh));
+
+  // a read-only pool cannot add pages
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+  ASSERT_EQUALS_INT(RC_POOL_READ_ONLY, pinNewPage(bm, h), "a read-only pool refuses new pages");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// freed pages are remembered in the header pages and reused before the file grows
+void
+testFreePageMap (void)
+{
+  SM_FileHandle fh;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle handles[2];
+  PageNumber first, pageNum, pages[2];
+  char *page = (char *) malloc(PAGE_SIZE);
+  int i;
+  testName = "Testing free-page map";
+
+  // a file without a map has nothing to allocate from
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(RC_NO_FREE_MAP, allocatePage(&fh, &pageNum), "a plain file has no free-space map");
+  ASSERT_TRUE(nextAllocatedPage(&fh, 0) == 0, "every page of a plain file holds data");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // the map of 100000 pages takes the first 4 pages, new pages follow them
+  CHECK(createPageFileWithFreeMap("testbuffer.bin", 100000));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  first = fh.totalNumPages;
+  ASSERT_TRUE(first == 4, "the header pages hold one bit per page");
+  for(i = 0; i < 5; i++)
+  {
+      CHECK(allocatePage(&fh, &pageNum));
+      ASSERT_TRUE(pageNum == first + i, "without free pages the file is extended");
+      memset(page, 0, PAGE_SIZE);
+      sprintf(page, "%s-%i", "Page", i);
+      CHECK(writeBlock(pageNum, &fh, page));
+  }
+  CHECK(freePage(&fh, first + 1, TRUE));
+  CHECK(freePage(&fh, first + 3, FALSE));
+  ASSERT_EQUALS_INT(RC_PAGE_NOT_ALLOCATED, freePage(&fh, first + 3, FALSE), "a page cannot be freed twice");
+  ASSERT_EQUALS_INT(RC_PAGE_NOT_ALLOCATED, freePage(&fh, 0, FALSE), "the map pages cannot be freed");
+  ASSERT_TRUE(getNumFreePages(&fh) == 2, "both freed pages are counted");
+  ASSERT_TRUE(nextAllocatedPage(&fh, 0) == first, "a scan starts after the map");
+  ASSERT_TRUE(nextAllocatedPage(&fh, first + 1) == first + 2, "a scan skips a free page");
+  ASSERT_TRUE(nextAllocatedPage(&fh, first + 3) == first + 4, "a scan skips another free page");
+  ASSERT_TRUE(nextAllocatedPage(&fh, first + 5) == -1, "a scan ends after the last page");
+  CHECK(readBlock(first + 1, &fh, page));
+  ASSERT_TRUE(page[0] == 0 || strcmp(page, "Page-1") == 0, "a punched page reads as zeros where holes are supported");
+  CHECK(closePageFile(&fh));
+
+  // the map survives reopening, the lowest free pages are reused zeroed
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_TRUE(getNumFreePages(&fh) == 2, "the free pages were kept in the header");
+  CHECK(allocatePage(&fh, &pageNum));
+  ASSERT_TRUE(pageNum == first + 1, "the lowest free page is reused first");
+  CHECK(allocatePage(&fh, &pageNum));
+  ASSERT_TRUE(pageNum == first + 3, "the next free page is reused");
+  CHECK(readBlock(pageNum, &fh, page));
+  ASSERT_EQUALS_INT(0, page[0], "a reused page is empty");
+  CHECK(allocatePage(&fh, &pageNum));
+  ASSERT_TRUE(pageNum == first + 5, "the file grows once no page is free");
+  ASSERT_TRUE(getNumFreePages(&fh) == 0, "no page is free");
+  CHECK(readBlock(first + 4, &fh, page));
+  ASSERT_EQUALS_STRING("Page-4", page, "allocated pages keep their data");
+  CHECK(closePageFile(&fh));
+
+  // the storage manager refuses to read or write the map pages, so the map survives
+  {
+    SM_PageHandle buffers[2] = {page, page};
+    RC results[2];
+
+    memset(page, 'x', PAGE_SIZE);
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    ASSERT_EQUALS_INT(RC_HEADER_PAGE, writeBlock(0, &fh, page), "writeBlock refuses the first map page");
+    ASSERT_EQUALS_INT(RC_HEADER_PAGE, writeBlocks(first - 1, 2, &fh, buffers), "writeBlocks refuses a run from a map page");
+    pages[0] = first;
+    pages[1] = 0;
+    ASSERT_EQUALS_INT(RC_HEADER_PAGE, writePages(pages, 2, &fh, buffers, results), "writePages refuses a batch with a map page");
+    ASSERT_TRUE(results[0] == RC_HEADER_PAGE && results[1] == RC_HEADER_PAGE, "nothing of the batch was written");
+    ASSERT_EQUALS_INT(RC_HEADER_PAGE, readFirstBlock(&fh, page), "readFirstBlock refuses the first map page");
+    ASSERT_EQUALS_INT(RC_HEADER_PAGE, readBlocks(0, 2, &fh, buffers), "readBlocks refuses the map pages");
+    CHECK(closePageFile(&fh));
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    ASSERT_TRUE(getNumHeaderPages(&fh) == first, "the map is still found after reopening");
+    ASSERT_TRUE(getNumFreePages(&fh) == 0 && fh.totalNumPages == first + 6, "the map still matches the file");
+    CHECK(readBlock(first, &fh, page));
+    ASSERT_EQUALS_STRING("Page-0", page, "the page after the map was not written");
+    CHECK(closePageFile(&fh));
+  }
+
+  // the pool leaves the map pages alone and takes its new pages from the map
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  ASSERT_EQUALS_INT(RC_HEADER_PAGE, pinPage(bm, h, 0), "the first map page cannot be pinned");
+  ASSERT_EQUALS_INT(RC_HEADER_PAGE, pinPage(bm, h, first - 1), "the last map page cannot be pinned");
+  pages[0] = first;
+  pages[1] = 1;
+  ASSERT_EQUALS_INT(RC_HEADER_PAGE, pinPages(bm, handles, pages, 2), "a batch with a map page is refused");
+  CHECK(pinPage(bm, h, first + 2));
+  ASSERT_EQUALS_STRING("Page-2", h->data, "a data page is pinned");
+  CHECK(unpinPage(bm, h));
+  CHECK(freePage(&(bm->fileHandle), first + 2, FALSE));
+  CHECK(pinNewPage(bm, h));
+  ASSERT_TRUE(h->pageNum == first + 2, "pinNewPage reuses a free page");
+  ASSERT_EQUALS_INT(0, h->data[0], "the frame the freed page still had is zeroed");
+  ASSERT_TRUE(h->dirty, "a reused page is dirty");
+  sprintf(h->data, "%s", "Reused");
+  CHECK(unpinPage(bm, h));
+  CHECK(pinNewPage(bm, h));
+  ASSERT_TRUE(h->pageNum == first + 6, "pinNewPage extends the file once no page is free");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_TRUE(getNumFreePages(&fh) == 0, "the pages pinNewPage took are allocated in the map");
+  ASSERT_TRUE(fh.totalNumPages == first + 7, "the file holds the extended page");
+  CHECK(readBlock(first + 2, &fh, page));
+  ASSERT_EQUALS_STRING("Reused", page, "the reused page was written back");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test that a prefetched page is evicted first until its first pin references it
+void
+testPrefetchNoReference (void)
+{
+  const ReplacementStrategy strategies[] = {RS_LRU, RS_CLOCK, RS_LRU_K, RS_LFU, RS_ARC, RS_2Q};
+  const PageNumber wanted[] = {2};
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int *fixCounts;
+  int i, hit, loaded, waited;
+  testName = "Testing prefetched pages are no reference";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+
+  for(i = 0; i < 6; i++)
+    for(hit = 0; hit < 2; hit++)
+    {
+      CHECK(initBufferPool(bm, "testbuffer.bin", 3, strategies[i], NULL));
+      CHECK(pinPage(bm, h, 0));
+      CHECK(unpinPage(bm, h));
+      CHECK(pinPage(bm, h, 1));
+      CHECK(unpinPage(bm, h));
+      CHECK(prefetchPages(bm, wanted, 1));
+      // wait up to two seconds until the prefetcher has read and released the page
+      loaded = FALSE;
+      for(waited = 0; waited < 2000 && !loaded; waited++)
+      {
+        usleep(1000);
+        fixCounts = getFixCounts(bm);
+        loaded = getNumPrefetchIO(bm) == 1 && fixCounts[2] == 0;
+        free(fixCounts);
+      }
+      ASSERT_TRUE(loaded, "the prefetcher read and released the page");
+
+      if (hit)
+      {
+        // the first pin is the first reference, the page is now the most recent one
+        CHECK(pinPage(bm, h, 2));
+        CHECK(unpinPage(bm, h));
+        CHECK(pinPage(bm, h, 3));
+        CHECK(unpinPage(bm, h));
+        ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "a pinned prefetched page is referenced");
+      }
+      else
+      {
+        CHECK(pinPage(bm, h, 3));
+        CHECK(unpinPage(bm, h));
+        ASSERT_EQUALS_POOL("[0 0],[1 0],[3 0]", bm, "an unpinned prefetched page goes first");
+      }
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// blocks are read and written at their own offset through the open descriptor, a short last page reads as zeros
+void
+testPositionedIO (void)
+{
+  const PageNumber order[] = {3, 1, 0, 2};
+  SM_FileHandle fh, other;
+  char *page = (char *) malloc(PAGE_SIZE);
+  char expected[16];
+  int i;
+  testName = "Testing positioned block I/O";
+
+  // pages written out of order land at their own offsets
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(ensureCapacity(4, &fh));
+  for(i = 0; i < 4; i++)
+  {
+      memset(page, 'x', PAGE_SIZE);
+      sprintf(page, "%s-%i", "Page", (int)order[i]);
+      CHECK(writeBlock(order[i], &fh, page));
+  }
+
+  // a second handle on the same file sees every write, whatever its position
+  CHECK(openPageFile("testbuffer.bin", &other));
+  ASSERT_EQUALS_INT(4, (int)other.totalNumPages, "the second handle counts every page");
+  CHECK(readLastBlock(&other, page));
+  for(i = 3; i >= 0; i--)
+  {
+      CHECK(readBlock(order[i], &other, page));
+      sprintf(expected, "%s-%i", "Page", (int)order[i]);
+      ASSERT_EQUALS_STRING(expected, page, "a block is read from its own offset");
+      ASSERT_EQUALS_INT('x', page[PAGE_SIZE - 1], "the whole page was written");
+  }
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, readBlock(4, &other, page), "a page past the end cannot be read");
+  CHECK(closePageFile(&other));
+  CHECK(closePageFile(&fh));
+
+  // a file cut inside its last page reads the missing bytes as zeros
+  ASSERT_TRUE(truncate("testbuffer.bin", 2 * PAGE_SIZE + PAGE_SIZE / 2) == 0, "the last page is cut in half");
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(3, (int)fh.totalNumPages, "a partial last page is counted");
+  CHECK(readBlock(2, &fh, page));
+  ASSERT_EQUALS_STRING("Page-2", page, "the kept half of the page is read");
+  ASSERT_EQUALS_INT('x', page[PAGE_SIZE / 2 - 1], "the kept half is whole");
+  ASSERT_EQUALS_INT(0, page[PAGE_SIZE / 2], "the cut half reads as zeros");
+  ASSERT_EQUALS_INT(0, page[PAGE_SIZE - 1], "the cut half reads as zeros up to the end of the page");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  TEST_DONE();
+}
+
+// a pool that cannot allocate its frames frees what it already has and closes the page file
+void
+testInitFailure (void)
+{
+  // the LRU-K history of 2^16 frames times 2^31 references is larger than any address space
+  BM_LRUKParams params = { .k = 0x7fffffff, .correlatedPeriod = 0 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int fd, next;
+  testName = "Testing a failed pool initialization";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 3);
+
+  fd = dup(0);
+  close(fd);
+  ASSERT_EQUALS_INT(RC_MEMORY_ALLOCATION_FAIL, initBufferPool(bm, "testbuffer.bin", 1 << 16, RS_LRU_K, &params),
+                    "a pool whose strategy cannot be allocated fails");
+  next = dup(0);
+  close(next);
+  ASSERT_EQUALS_INT(fd, next, "the failed pool closed its page file");
+
+  // the same pool structure can be set up again
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, NULL));
+  CHECK(pinPage(bm, h, 2));
+  ASSERT_EQUALS_STRING("Page-2", h->data, "the pool set up after the failure reads its pages");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test that LRU orders frames by the release of their last pin, not by the pin
+void
+testLRURelease (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    // pages 0, 1 and 2 are pinned in this order and released as 2, 0, 1
+    "[0 1],[1 1],[2 1]",
+    "[0 0],[1 0],[2 0]",
+    // the page released first is evicted first
+    "[0 0],[1 0],[3 0]",
+    "[4 0],[1 0],[3 0]",
+    "[4 0],[5 0],[3 0]"
+  };
+  const int releases[] = {2,0,1};
+
+  int i;
+  int snapshot = 0;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle handles[3];
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing LRU release order";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+  for(i = 0; i < 3; i++)
+      CHECK(pinPage(bm, &handles[i], i));
+  ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "every page is pinned");
+  for(i = 0; i < 3; i++)
+      CHECK(unpinPage(bm, &handles[releases[i]]));
+  ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "every page is released");
+
+  for(i = 0; i < 3; i++)
+  {
+      CHECK(pinPage(bm, h, 3 + i));
+      CHECK(unpinPage(bm, h));
+      ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "pages are evicted in release order");
+  }
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// hit page 0 three times, then report through failures (-1 until done)
+static void *
+hitPageZero (void *arg)
+{
+  ConcurrentArgs *args = (ConcurrentArgs *) arg;
+  BM_PageHandle h;
+  int i, failures = 0;
+
+  for(i = 0; i < 3; i++)
+  {
+      if (pinPage(args->bm, &h, 0) != RC_OK)
+        failures++;
+      unpinPage(args->bm, &h);
+  }
+  __atomic_store_n(&(args->failures), failures, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+// pin page 0 once and keep it, then report through failures (-1 until done)
+static void *
+pinPageZero (void *arg)
+{
+  ConcurrentArgs *args = (ConcurrentArgs *) arg;
+  BM_PageHandle h;
+
+  __atomic_store_n(&(args->failures), pinPage(args->bm, &h, 0) == RC_OK ? 0 : 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+// test that hits do not wait for a taken strategy latch and that a full pin count waits for an unpin
+void
+testLatchedHits (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  pthread_t thread;
+  ConcurrentArgs args;
+  int *fixCounts;
+  bool *dirtyFlags;
+  int i;
+  testName = "Testing hits while the strategy latch is taken";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 5);
+
+  // LFU hits are left for the holder of the latch and still count before the next victim is chosen
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+  for(i = 0; i < 3; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+  }
+  args.bm = bm;
+  args.failures = -1;
+  pthread_mutex_lock(&(bm->strategyLatch));
+  pthread_create(&thread, NULL, hitPageZero, &args);
+  for(i = 0; i < 2000 && __atomic_load_n(&(args.failures), __ATOMIC_ACQUIRE) == -1; i++)
+      usleep(1000);
+  ASSERT_EQUALS_INT(0, __atomic_load_n(&(args.failures), __ATOMIC_ACQUIRE), "hits do not wait for the strategy latch");
+  pthread_mutex_unlock(&(bm->strategyLatch));
+  pthread_join(thread, NULL);
+  CHECK(pinPage(bm, h, 3));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 0],[3 0],[2 0]", bm, "the left hits kept page 0 in the pool");
+  CHECK(shutdownBufferPool(bm));
+
+  // a page whose pin count is full makes the next pin wait instead of overflowing into the flags
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for(i = 0; i < 0xFFFF; i++)
+      CHECK(pinPage(bm, h, 0));
+  args.failures = -1;
+  pthread_create(&thread, NULL, pinPageZero, &args);
+  usleep(50000);
+  ASSERT_EQUALS_INT(-1, __atomic_load_n(&(args.failures), __ATOMIC_ACQUIRE), "a pin past the limit waits");
+  CHECK(unpinPage(bm, h));
+  pthread_join(thread, NULL);
+  ASSERT_EQUALS_INT(0, args.failures, "the waiting pin gets the released one");
+  fixCounts = getFixCounts(bm);
+  dirtyFlags = getDirtyFlags(bm);
+  ASSERT_EQUALS_INT(0xFFFF, fixCounts[0], "the pin count stays at the limit");
+  ASSERT_TRUE(!dirtyFlags[0], "the pins did not spill into the dirty flag");
+  free(fixCounts);
+  free(dirtyFlags);
+  for(i = 0; i < 0xFFFF; i++)
+      CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}